@@ -2,6 +2,7 @@
 #include "StudentWorld.h"
 #include "GameConstants.h"
 #include "GameWorld.h"
+#include "StateHash.h"
 #include <cmath>
 #include <algorithm>
 using namespace std;
@@ -13,6 +14,37 @@ Actor::Actor(int imageID, double startX, double startY, Direction startDirection
 {
 	m_alive = true;
 	m_studWorld = studWorld;
+	m_serial = studWorld->nextActorSerial();
+	m_digest = 0;
+	rehash();
+}
+
+Actor::~Actor()
+{
+	m_studWorld->updateStateHash(m_digest, 0);	//remove this actor's contribution
+}
+
+void Actor::rehash()
+{
+	uint64_t h = StateHash::mix(0, static_cast<uint64_t>(m_serial));
+	h = StateHash::mix(h, getImageID());
+	h = StateHash::mix(h, getX());
+	h = StateHash::mix(h, getY());
+	h = StateHash::mix(h, getDirection());
+	h = StateHash::mix(h, m_alive ? 1 : 0);
+	uint64_t newDigest = hashState(h);
+	m_studWorld->updateStateHash(m_digest, newDigest);
+	m_digest = newDigest;
+}
+
+uint64_t Actor::hashState(uint64_t h) const
+{
+	return h;
+}
+
+void Actor::stateChanged()
+{
+	rehash();
 }
 
 bool Actor::damage(int hp)
@@ -29,6 +61,7 @@ ActorWithHP::ActorWithHP(int imageID, double startX, double startY, Direction st
 : Actor(imageID, startX, startY, startDirection, 0, studWorld)
 {
 	m_health = starthp;
+	rehash();
 }
 
 bool ActorWithHP::setHealth(int hp)
@@ -36,22 +69,29 @@ bool ActorWithHP::setHealth(int hp)
 	if (hp <= 0)
 		return false;
 	m_health = hp;
+	rehash();
 	return true;
 }
 
+uint64_t ActorWithHP::hashState(uint64_t h) const
+{
+	return StateHash::mix(Actor::hashState(h), m_health);
+}
+
 bool ActorWithHP::damage(int hp)
 {
 	if (!alive() || hp <= 0)
 		return false;
 	m_health -= hp;
+	rehash();
 	if (m_health <= 0)
 	{
 		setDead();	//dies if hp reaches 0
-		myStudWorld()->playSound(soundWhenDie());
+		myStudWorld()->queueSound(soundWhenDie());
 	}
 	else
 	{
-		myStudWorld()->playSound(soundWhenHurt());
+		myStudWorld()->queueSound(soundWhenHurt());
 	}
 	return true;
 }
@@ -63,6 +103,7 @@ Socrates::Socrates(double startX, double startY, StudentWorld* studWorld)
 {
 	m_numSpray = 20;
 	m_numFlame = 5;
+	rehash();
 }
 
 bool Socrates::addFlame(int num)
@@ -70,11 +111,18 @@ bool Socrates::addFlame(int num)
 	if (num > 0)
 	{
 		m_numFlame += num;
+		rehash();
 		return true;
 	}
 	return false;
 }
 
+uint64_t Socrates::hashState(uint64_t h) const
+{
+	h = StateHash::mix(ActorWithHP::hashState(h), m_numSpray);
+	return StateHash::mix(h, m_numFlame);
+}
+
 void Socrates::doSomething()
 {
 	if (!alive())
@@ -94,8 +142,9 @@ void Socrates::doSomething()
 				double newX, newY;
 				projectileXY(0, newX, newY);
 				myStudWorld()->addActor(new Spray(newX, newY, getDirection(), myStudWorld()));
-				myStudWorld()->playSound(SOUND_PLAYER_SPRAY);
+				myStudWorld()->queueSound(SOUND_PLAYER_SPRAY);
 				m_numSpray--;
+				rehash();
 			}
 			break;
 		case KEY_PRESS_ENTER:
@@ -107,14 +156,18 @@ void Socrates::doSomething()
 					projectileXY(22 * i, newX, newY);
 					myStudWorld()->addActor(new Flame(newX, newY, getDirection() + 22 * i, myStudWorld()));
 				}
-				myStudWorld()->playSound(SOUND_PLAYER_FIRE);
+				myStudWorld()->queueSound(SOUND_PLAYER_FIRE);
 				m_numFlame--;
+				rehash();
 			}
 			break;
 		}
 	}
 	else if (m_numSpray < 20)
+	{
 		m_numSpray++;
+		rehash();
+	}
 }
 
 bool Socrates::moveAlongRim(const int keyPressed)
@@ -156,7 +209,8 @@ Bacteria::Bacteria(int imageID, double startX, double startY, StudentWorld* stud
 	m_foodEaten = 0;
 	m_movePlan = 0;
 	m_toxicity = toxicity;
-	myStudWorld()->playSound(SOUND_BACTERIUM_BORN);
+	rehash();
+	myStudWorld()->queueSound(SOUND_BACTERIUM_BORN);
 	myStudWorld()->incBacteria();
 }
 
@@ -165,6 +219,7 @@ bool Bacteria::resetFood()
 	if (m_foodEaten >= 3)
 	{
 		m_foodEaten = 0;
+		rehash();
 		return true;
 	}
 	return false;
@@ -175,6 +230,7 @@ bool Bacteria::eat(Actor* food)
 	if (food != nullptr)
 	{
 		m_foodEaten++;
+		rehash();
 		food->setDead();
 		return true;
 	}
@@ -185,6 +241,7 @@ void Bacteria::setRandDirection()
 {
 	setDirection(randInt(0, 359));
 	m_movePlan = 10;
+	rehash();
 }
 
 bool Bacteria::decMove()
@@ -192,6 +249,7 @@ bool Bacteria::decMove()
 	if (m_movePlan >= 0)
 	{
 		m_movePlan--;
+		rehash();
 		return true;
 	}
 	return false;
@@ -202,11 +260,19 @@ bool Bacteria::setMove(int step)
 	if (step >= 0)
 	{
 		m_movePlan = step;
+		rehash();
 		return true;
 	}
 	return false;
 }
 
+uint64_t Bacteria::hashState(uint64_t h) const
+{
+	h = StateHash::mix(ActorWithHP::hashState(h), m_foodEaten);
+	h = StateHash::mix(h, m_movePlan);
+	return StateHash::mix(h, m_toxicity);
+}
+
 void Bacteria::doSomething()
 {
 	if (!alive())
@@ -246,7 +312,7 @@ bool Bacteria::damage(int hp)
 	{
 		if (!alive())
 		{
-			myStudWorld()->increaseScore(100);
+			myStudWorld()->queueScore(100);
 			turnIntoFood();
 		}
 		return true;
@@ -383,6 +449,7 @@ void Ecoli::specificBehavior()
 Dirt::Dirt(double startX, double startY, StudentWorld* studWorld)
 : Actor(IID_DIRT, startX, startY, 0, 1, studWorld)
 {
+	setStatic();
 }
 
 //Food class implementation
@@ -400,6 +467,12 @@ Projectile::Projectile(int imageID, double startX, double startY, Direction star
 	m_distTraveled = 0;
 	m_range = range;
 	m_damage = damage;
+	rehash();
+}
+
+uint64_t Projectile::hashState(uint64_t h) const
+{
+	return StateHash::mix(Actor::hashState(h), m_distTraveled);
 }
 
 void Projectile::doSomething()
@@ -410,6 +483,7 @@ void Projectile::doSomething()
 		return;
 	moveForward(SPRITE_RADIUS * 2);
 	m_distTraveled += SPRITE_RADIUS * 2;
+	rehash();
 	if (rangeReached())
 		setDead();
 }
@@ -446,6 +520,13 @@ Goodie::Goodie(int imageID, double startX, double startY, StudentWorld* studWorl
 {
 	m_age = 0;
 	m_lifetime = lifetime;
+	rehash();
+}
+
+uint64_t Goodie::hashState(uint64_t h) const
+{
+	h = StateHash::mix(Actor::hashState(h), m_age);
+	return StateHash::mix(h, m_lifetime);
 }
 
 void Goodie::doSomething()
@@ -459,6 +540,7 @@ void Goodie::doSomething()
 		return;
 	}
 	m_age++;
+	rehash();
 	if (LifetimeReached())
 		setDead();
 }
@@ -474,8 +556,8 @@ void RestoreHealthGoodie::pickUp(Socrates* player)
 {
 	if (player != nullptr)
 	{
-		myStudWorld()->increaseScore(250);
-		myStudWorld()->playSound(SOUND_GOT_GOODIE);
+		myStudWorld()->queueScore(250);
+		myStudWorld()->queueSound(SOUND_GOT_GOODIE);
 		player->completeHeal();
 	}
 }
@@ -491,8 +573,8 @@ void FlameThrowerGoodie::pickUp(Socrates* player)
 {
 	if (player != nullptr)
 	{
-		myStudWorld()->increaseScore(300);
-		myStudWorld()->playSound(SOUND_GOT_GOODIE);
+		myStudWorld()->queueScore(300);
+		myStudWorld()->queueSound(SOUND_GOT_GOODIE);
 		player->addFlame(5);
 	}
 }
@@ -508,9 +590,9 @@ void ExtraLifeGoodie::pickUp(Socrates* player)
 {
 	if (player != nullptr)
 	{
-		myStudWorld()->increaseScore(500);
-		myStudWorld()->playSound(SOUND_GOT_GOODIE);
-		myStudWorld()->incLives();
+		myStudWorld()->queueScore(500);
+		myStudWorld()->queueSound(SOUND_GOT_GOODIE);
+		myStudWorld()->queueExtraLife();
 	}
 }
 
@@ -525,7 +607,7 @@ void Fungus::pickUp(Socrates* player)
 {
 	if (player != nullptr)
 	{
-		myStudWorld()->increaseScore(-50);
+		myStudWorld()->queueScore(-50);
 		player->damage(20);
 	}
 }
@@ -538,6 +620,15 @@ Pit::Pit(double startX, double startY, StudentWorld* studWorld)
 	numSalmon = 5;
 	numAggroSalmon = 3;
 	numEcoli = 2;
+	setStatic();
+	rehash();
+}
+
+uint64_t Pit::hashState(uint64_t h) const
+{
+	h = StateHash::mix(Actor::hashState(h), numSalmon);
+	h = StateHash::mix(h, numAggroSalmon);
+	return StateHash::mix(h, numEcoli);
 }
 
 void Pit::doSomething()
@@ -562,6 +653,7 @@ void Pit::doSomething()
 					emitted = true;
 					myStudWorld()->addActor(new Salmonella(getX(), getY(), myStudWorld()));
 					numSalmon--;
+					rehash();
 				}
 				break;
 			case 1:
@@ -570,6 +662,7 @@ void Pit::doSomething()
 					emitted = true;
 					myStudWorld()->addActor(new AggressiveSalmonella(getX(), getY(), myStudWorld()));
 					numAggroSalmon--;
+					rehash();
 				}
 				break;
 			case 2:
@@ -578,6 +671,7 @@ void Pit::doSomething()
 					emitted = true;
 					myStudWorld()->addActor(new Ecoli(getX(), getY(), myStudWorld()));
 					numEcoli--;
+					rehash();
 				}
 				break;
 			}
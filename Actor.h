@@ -2,6 +2,7 @@
 #define ACTOR_H_
 
 #include "GraphObject.h"
+#include <cstdint>
 
 class StudentWorld;
 
@@ -33,14 +34,29 @@ public:
 
 	Actor* getMe();
 
-	virtual ~Actor()
-	{}
+	uint32_t serial() const;
+	//return the creation order of the actor, stable across identical runs
+
+	uint64_t digest() const;
+	//return the actor's current contribution to the world state hash
+
+	virtual ~Actor();
 protected:
 	StudentWorld* myStudWorld() const;
 
+	void rehash();
+	//recompute the digest after a hashed field changed
+
+	virtual uint64_t hashState(uint64_t h) const;
+	//fold the fields specific to each kind of actor into h
+
+	virtual void stateChanged();
+
 private:
 	bool m_alive;
 	StudentWorld* m_studWorld;
+	uint32_t m_serial;
+	uint64_t m_digest;
 };
 
 class ActorWithHP : public Actor
@@ -60,6 +76,8 @@ protected:
 	bool setHealth(int hp);
 	//return whether health is successfully reset
 
+	virtual uint64_t hashState(uint64_t h) const;
+
 private:
 	int m_health;
 
@@ -90,6 +108,8 @@ public:
 
 	virtual ~Socrates()
 	{}
+protected:
+	virtual uint64_t hashState(uint64_t h) const;
 private:
 	int m_numSpray;
 	int m_numFlame;
@@ -135,6 +155,8 @@ protected:
 	bool turnIntoFood() const;
 
 	void setRandDirection();
+
+	virtual uint64_t hashState(uint64_t h) const;
 private:
 	int m_foodEaten;
 	int m_movePlan;
@@ -250,6 +272,8 @@ public:
 
 	virtual ~Projectile()
 	{}
+protected:
+	virtual uint64_t hashState(uint64_t h) const;
 private:
 	int m_distTraveled;
 	int m_range;
@@ -289,6 +313,8 @@ public:
 
 	virtual ~Goodie()
 	{}
+protected:
+	virtual uint64_t hashState(uint64_t h) const;
 private:
 	int m_age;
 	int m_lifetime;
@@ -352,6 +378,8 @@ public:
 	virtual void doSomething();
 
 	virtual ~Pit();
+protected:
+	virtual uint64_t hashState(uint64_t h) const;
 private:
 	int numSalmon;
 	int numAggroSalmon;
@@ -370,6 +398,7 @@ inline bool Actor::alive() const
 inline void Actor::setDead()
 {
 	m_alive = false;
+	rehash();
 }
 
 inline bool Actor::damageable() const
@@ -402,6 +431,16 @@ inline Actor* Actor::getMe()
 	return this;
 }
 
+inline uint32_t Actor::serial() const
+{
+	return m_serial;
+}
+
+inline uint64_t Actor::digest() const
+{
+	return m_digest;
+}
+
 inline int ActorWithHP::health() const
 {
 	return m_health;
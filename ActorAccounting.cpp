@@ -0,0 +1,126 @@
+#include "ActorAccounting.h"
+#include "Actor.h"
+#include "GameConstants.h"
+#include <typeinfo>
+#include <iomanip>
+using namespace std;
+
+static const char* TYPE_NAMES[ActorAccounting::NUM_TYPES] = {
+    "Socrates", "Salmonella", "AggressiveSalmonella", "Ecoli", "Dirt", "Food", "Flame", "Spray",
+    "RestoreHealthGoodie", "FlameThrowerGoodie", "ExtraLifeGoodie", "Fungus", "Pit"
+};
+
+static const char* QUERY_NAMES[ActorTypeCost::NUM_QUERIES] = {
+    "moveOverlap", "dealDamage", "eatFood", "findClosestFood"
+};
+
+  // The image tells the types apart, but for the two kinds of Salmonella.
+ActorAccounting::Type ActorAccounting::typeOf(const Actor* actor)
+{
+    switch (actor->getImageID())
+    {
+        case IID_PLAYER:                return socrates;
+        case IID_SALMONELLA:
+            return typeid(*actor) == typeid(AggressiveSalmonella) ? aggressiveSalmonella : salmonella;
+        case IID_ECOLI:                 return ecoli;
+        case IID_DIRT:                  return dirt;
+        case IID_FOOD:                  return food;
+        case IID_FLAME:                 return flame;
+        case IID_SPRAY:                 return spray;
+        case IID_RESTORE_HEALTH_GOODIE: return restoreHealthGoodie;
+        case IID_FLAME_THROWER_GOODIE:  return flameThrowerGoodie;
+        case IID_EXTRA_LIFE_GOODIE:     return extraLifeGoodie;
+        case IID_FUNGUS:                return fungus;
+        default:                        return pit;
+    }
+}
+
+bool ActorAccounting::openTickLog(const string& fileName)
+{
+    m_tickLog.open(fileName, ios::out|ios::trunc);
+    if (!m_tickLog)
+        return false;
+    m_tickLog << "tick,level,type,alive,updates,update_ns";
+    for (const char* q : QUERY_NAMES)
+        m_tickLog << ',' << q << ',' << q << "_ns";
+    m_tickLog << '\n';
+    return true;
+}
+
+void ActorAccounting::endTick(int level)
+{
+    m_levelTicks++;
+    m_runTicks++;
+    for (int t = 0; t < NUM_TYPES; t++)
+    {
+        ActorTypeCost& tick = m_tick[t];
+        if (tick.empty())
+            continue;
+        if (m_tickLog.is_open())
+        {
+            m_tickLog << m_runTicks << ',' << level << ',' << TYPE_NAMES[t] << ',' << tick.population
+                      << ',' << tick.updates << ',' << tick.updateNs;
+            for (int q = 0; q < ActorTypeCost::NUM_QUERIES; q++)
+                m_tickLog << ',' << tick.queries[q] << ',' << tick.queryNs[q];
+            m_tickLog << '\n';
+        }
+        for (ActorTypeCost* total : { &m_level[t], &m_run[t] })
+        {
+            total->updates += tick.updates;
+            total->updateNs += tick.updateNs;
+            total->maxTickUpdateNs = max(total->maxTickUpdateNs, tick.updateNs);
+            for (int q = 0; q < ActorTypeCost::NUM_QUERIES; q++)
+            {
+                total->queries[q] += tick.queries[q];
+                total->queryNs[q] += tick.queryNs[q];
+            }
+            total->population += tick.population;
+            total->maxPopulation = max(total->maxPopulation, static_cast<int>(tick.population));
+        }
+        tick = ActorTypeCost();
+    }
+}
+
+void ActorAccounting::endLevel(ostream& os, int level, const char* outcome)
+{
+    os << "Actor types, level " << level << " (" << outcome << "), " << m_levelTicks << " ticks:" << endl;
+    print(os, m_level, m_levelTicks);
+    for (ActorTypeCost& c : m_level)
+        c = ActorTypeCost();
+    m_levelTicks = 0;
+    m_tickLog.flush();
+}
+
+void ActorAccounting::printRun(ostream& os) const
+{
+    os << "Actor types, whole run, " << m_runTicks << " ticks:" << endl;
+    print(os, m_run, m_runTicks);
+}
+
+  // One line per type seen, its figures averaged over the ticks; queries
+  // are listed only if the type made any.
+void ActorAccounting::print(ostream& os, const ActorTypeCost* costs, long long ticks)
+{
+    if (ticks == 0)
+        return;
+    os << fixed << setprecision(2);
+    for (int t = 0; t < NUM_TYPES; t++)
+    {
+        const ActorTypeCost& c = costs[t];
+        if (c.empty())
+            continue;
+        os << "  " << left << setw(21) << TYPE_NAMES[t] << right
+           << "alive " << static_cast<double>(c.population) / ticks << " (max " << c.maxPopulation << "), "
+           << "update " << c.updateNs / 1000.0 / ticks << " us/tick (max " << c.maxTickUpdateNs / 1000.0
+           << "), " << (c.updates > 0 ? c.updateNs / c.updates : 0) << " ns each";
+        for (int q = 0; q < ActorTypeCost::NUM_QUERIES; q++)
+        {
+            if (c.queries[q] > 0)
+            {
+                os << "; " << QUERY_NAMES[q] << ' ' << static_cast<double>(c.queries[q]) / ticks
+                   << "/tick, " << c.queryNs[q] / 1000.0 / ticks << " us/tick";
+            }
+        }
+        os << endl;
+    }
+}
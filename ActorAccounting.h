@@ -0,0 +1,153 @@
+#ifndef ACTORACCOUNTING_H_
+#define ACTORACCOUNTING_H_
+
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <algorithm>
+
+class Actor;
+
+  // What each concrete kind of actor costs a tick: how many are alive, how
+  // long their doSomething calls take, and how often they call into the
+  // world's queries and for how long.  Like TickProfiler, compiled in only
+  // when KONTAGION_PROFILE is defined; otherwise the ACCOUNT_ macros below
+  // expand to nothing.
+  //
+  // doSomething times are laps, one clock read per actor, and include the
+  // queries the actor made.  Everything is gathered per tick, written out
+  // per tick to the tick log if one is open, and folded into totals for the
+  // level and the run, printed when a level ends and at exit.  All of it is
+  // touched only by the thread running the world.
+
+struct ActorTypeCost
+{
+    static const int NUM_QUERIES = 4;
+
+    long long updates = 0;              // doSomething calls
+    long long updateNs = 0;
+    long long maxTickUpdateNs = 0;      // most of it in one tick
+    long long queries[NUM_QUERIES] = {};
+    long long queryNs[NUM_QUERIES] = {};
+    long long population = 0;           // alive at the end of each tick, summed
+    int       maxPopulation = 0;
+
+    bool empty() const
+    {
+        return updates == 0  &&  population == 0;
+    }
+};
+
+class ActorAccounting
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Type { socrates, salmonella, aggressiveSalmonella, ecoli, dirt, food, flame, spray,
+                restoreHealthGoodie, flameThrowerGoodie, extraLifeGoodie, fungus, pit, NUM_TYPES };
+    enum Query { moveOverlap, dealDamage, eatFood, findClosestFood };
+
+    static ActorAccounting& instance()
+    {
+        static ActorAccounting accounting;
+        return accounting;
+    }
+
+    static Type typeOf(const Actor* actor);
+
+      // Write a CSV row per tick and actor type to fileName.
+    bool openTickLog(const std::string& fileName);
+
+      // Start timing doSomething calls.
+    void mark()
+    {
+        m_lap = Clock::now();
+    }
+
+      // The doSomething call since the last mark or update was actor's.
+    void updated(const Actor* actor)
+    {
+        Clock::time_point now = Clock::now();
+        ActorTypeCost& c = m_tick[typeOf(actor)];
+        c.updates++;
+        c.updateNs += nsBetween(m_lap, now);
+        m_lap = now;
+    }
+
+    void alive(const Actor* actor)
+    {
+        m_tick[typeOf(actor)].population++;
+    }
+
+      // Times a query for as long as it is in scope.
+    class QueryScope
+    {
+      public:
+        QueryScope(Query query, const Actor* actor)
+         : m_cost(instance().m_tick[typeOf(actor)]), m_query(query), m_start(Clock::now())
+        {
+        }
+
+        ~QueryScope()
+        {
+            m_cost.queries[m_query]++;
+            m_cost.queryNs[m_query] += nsBetween(m_start, Clock::now());
+        }
+
+        QueryScope(const QueryScope&) = delete;
+        QueryScope& operator=(const QueryScope&) = delete;
+
+      private:
+        ActorTypeCost&    m_cost;
+        Query             m_query;
+        Clock::time_point m_start;
+    };
+
+    void endTick(int level);
+    void endLevel(std::ostream& os, int level, const char* outcome);
+    void printRun(std::ostream& os) const;
+
+    ActorAccounting(const ActorAccounting&) = delete;
+    ActorAccounting& operator=(const ActorAccounting&) = delete;
+
+  private:
+    ActorTypeCost     m_tick[NUM_TYPES];
+    ActorTypeCost     m_level[NUM_TYPES];
+    ActorTypeCost     m_run[NUM_TYPES];
+    long long         m_levelTicks = 0;
+    long long         m_runTicks = 0;
+    Clock::time_point m_lap;
+    std::ofstream     m_tickLog;
+
+    ActorAccounting()
+    {
+    }
+
+    static void print(std::ostream& os, const ActorTypeCost* costs, long long ticks);
+
+    static long long nsBetween(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    }
+};
+
+#ifdef KONTAGION_PROFILE
+#define ACCOUNT_UPDATES_BEGIN()                 ActorAccounting::instance().mark()
+#define ACCOUNT_UPDATED(actor)                  ActorAccounting::instance().updated(actor)
+#define ACCOUNT_ALIVE(actor)                    ActorAccounting::instance().alive(actor)
+#define ACCOUNT_QUERY(query, actor)             ActorAccounting::QueryScope accountQuery(ActorAccounting::query, actor)
+#define ACCOUNT_TICK_END(level)                 ActorAccounting::instance().endTick(level)
+#define ACCOUNT_LEVEL_END(os, level, outcome)   ActorAccounting::instance().endLevel(os, level, outcome)
+#define ACCOUNT_REPORT(os)                      ActorAccounting::instance().printRun(os)
+#else
+#define ACCOUNT_UPDATES_BEGIN()                 ((void)0)
+#define ACCOUNT_UPDATED(actor)                  ((void)0)
+#define ACCOUNT_ALIVE(actor)                    ((void)0)
+#define ACCOUNT_QUERY(query, actor)             ((void)0)
+#define ACCOUNT_TICK_END(level)                 ((void)0)
+#define ACCOUNT_LEVEL_END(os, level, outcome)   ((void)0)
+#define ACCOUNT_REPORT(os)                      ((void)0)
+#endif
+
+#endif // ACTORACCOUNTING_H_
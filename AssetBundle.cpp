@@ -0,0 +1,407 @@
+#include "AssetBundle.h"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+using namespace std;
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+
+static const char BUNDLE_MAGIC[4] = { 'K', 'A', 'S', 'B' };
+static const uint32_t BUNDLE_VERSION = 2;
+
+template<typename T>
+static void writeValue(ofstream& f, const T& value)
+{
+    f.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static bool hasExtension(const string& name, const char* extension)
+{
+    size_t len = strlen(extension);
+    if (name.size() <= len)
+        return false;
+    for (size_t k = 0; k < len; k++)
+    {
+        if (tolower(static_cast<unsigned char>(name[name.size() - len + k])) != extension[k])
+            return false;
+    }
+    return true;
+}
+
+static vector<string> listDirectory(const string& directory)
+{
+    vector<string> names;
+#ifdef _MSC_VER
+    WIN32_FIND_DATAA found;
+    HANDLE h = FindFirstFileA((directory + "/*").c_str(), &found);
+    if (h == INVALID_HANDLE_VALUE)
+        return names;
+    do
+    {
+        if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            names.push_back(found.cFileName);
+    } while (FindNextFileA(h, &found));
+    FindClose(h);
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr)
+        return names;
+    while (dirent* d = readdir(dir))
+    {
+        if (d->d_name[0] != '.')
+            names.push_back(d->d_name);
+    }
+    closedir(dir);
+#endif
+    sort(names.begin(), names.end());
+    return names;
+}
+
+  // Last modification time, in the platform's own units; false if the
+  // file isn't there.
+static bool modifiedTime(const string& path, uint64_t& time)
+{
+#ifdef _MSC_VER
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data))
+        return false;
+    time = static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat statbuf;
+    if (stat(path.c_str(), &statbuf) != 0)
+        return false;
+#if defined(__APPLE__)
+    const timespec& t = statbuf.st_mtimespec;
+#else
+    const timespec& t = statbuf.st_mtim;
+#endif
+    time = static_cast<uint64_t>(t.tv_sec) * 1000000000 + static_cast<uint64_t>(t.tv_nsec);
+#endif
+    return true;
+}
+
+AssetBundle::AssetBundle()
+ : m_base(nullptr), m_length(0)
+#ifdef _MSC_VER
+ , m_fileHandle(nullptr), m_mappingHandle(nullptr)
+#endif
+{
+}
+
+AssetBundle::~AssetBundle()
+{
+    close();
+}
+
+bool AssetBundle::open(const string& fileName)
+{
+    close();
+    if (!map(fileName))
+        return false;
+    if (m_length < sizeof(Header))
+    {
+        close();
+        return false;
+    }
+    Header header;
+    memcpy(&header, m_base, sizeof(header));
+    if (!equal(header.magic, header.magic + sizeof(header.magic), BUNDLE_MAGIC)  ||
+        header.version != BUNDLE_VERSION  ||
+        header.count > (m_length - sizeof(Header)) / sizeof(Entry))
+    {
+        close();
+        return false;
+    }
+    m_entries.resize(header.count);
+    if (header.count > 0)
+        memcpy(m_entries.data(), m_base + sizeof(Header), header.count * sizeof(Entry));
+    if (!validate())
+    {
+        close();
+        return false;
+    }
+    sort(m_entries.begin(), m_entries.end(),
+        [](const Entry& a, const Entry& b) { return strncmp(a.name, b.name, NAME_SIZE) < 0; });
+    return true;
+}
+
+void AssetBundle::close()
+{
+    unmap();
+    m_entries.clear();
+}
+
+  // Every entry must name its data inside the file, and hold as many bytes
+  // as its format says; nothing is trusted further than that.
+bool AssetBundle::validate() const
+{
+    for (const Entry& e : m_entries)
+    {
+        if (e.name[NAME_SIZE - 1] != '\0'  ||  e.offset > m_length  ||  e.size > m_length - e.offset)
+            return false;
+        if (e.kind == spriteKind)
+        {
+            if (e.bits != 32  ||  e.width == 0  ||  e.height == 0  ||
+                e.size != static_cast<uint64_t>(e.width) * e.height * 4  ||
+                e.mipSize != SpriteCell::mipBytes(SpriteCell::cellSize(e.width), SpriteCell::cellSize(e.height))  ||
+                e.mipOffset > m_length  ||  e.mipSize > m_length - e.mipOffset)
+                return false;
+        }
+        else if (e.kind == soundKind)
+        {
+            if (e.width < 1  ||  e.width > 2  ||  e.height == 0  ||  (e.bits != 8  &&  e.bits != 16)  ||
+                e.size % (e.width * e.bits / 8) != 0)
+                return false;
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+const AssetBundle::Entry* AssetBundle::find(const string& name, uint32_t kind) const
+{
+    if (name.size() >= NAME_SIZE)
+        return nullptr;
+    auto it = lower_bound(m_entries.begin(), m_entries.end(), name,
+        [](const Entry& e, const string& n) { return strncmp(e.name, n.c_str(), NAME_SIZE) < 0; });
+    if (it == m_entries.end()  ||  name != it->name  ||  it->kind != kind)
+        return nullptr;
+    return &*it;
+}
+
+bool AssetBundle::sprite(const string& name, ImageView& image) const
+{
+    const Entry* e = find(name, spriteKind);
+    if (e == nullptr)
+        return false;
+    image.width = e->width;
+    image.height = e->height;
+    image.bgra = m_base + e->offset;
+    image.mips = m_base + e->mipOffset;
+    return true;
+}
+
+bool AssetBundle::sound(const string& name, PcmClip& clip) const
+{
+    const Entry* e = find(name, soundKind);
+    if (e == nullptr)
+        return false;
+    clip.channels = static_cast<int>(e->width);
+    clip.sampleRate = static_cast<int>(e->height);
+    clip.bitsPerSample = static_cast<int>(e->bits);
+    clip.data.clear();
+    clip.mapped = reinterpret_cast<const char*>(m_base + e->offset);
+    clip.mappedSize = static_cast<size_t>(e->size);
+    clip.path.clear();
+    return true;
+}
+
+bool AssetBundle::isOlderThan(const string& bundleFile, const string& assetDirectory)
+{
+    uint64_t bundleTime;
+    if (!modifiedTime(bundleFile, bundleTime))
+        return false;
+    for (const string& name : listDirectory(assetDirectory))
+    {
+        uint64_t assetTime;
+        if ((hasExtension(name, ".tga")  ||  hasExtension(name, ".wav"))  &&
+            modifiedTime(assetDirectory + "/" + name, assetTime)  &&  assetTime > bundleTime)
+            return true;
+    }
+    return false;
+}
+
+bool AssetBundle::pack(const string& assetDirectory, const string& bundleFile, ostream& log)
+{
+    vector<string> spriteNames, soundNames;
+    for (const string& name : listDirectory(assetDirectory))
+    {
+        if (name.size() >= NAME_SIZE)
+            log << "Skipping " << name << ": name too long" << endl;
+        else if (hasExtension(name, ".tga"))
+            spriteNames.push_back(name);
+        else if (hasExtension(name, ".wav"))
+            soundNames.push_back(name);
+    }
+
+    vector<string> spriteFiles;
+    for (const string& name : spriteNames)
+        spriteFiles.push_back(assetDirectory + "/" + name);
+    vector<TgaImage> images = TgaImage::loadAll(spriteFiles);
+    vector<SpriteCell> cells(images.size());
+    for (size_t k = 0; k < images.size(); k++)
+    {
+        if (!images[k].empty())
+            cells[k].build(images[k].view());     // the mip chain, done here once and for all
+    }
+    vector<PcmClip> clips(soundNames.size());
+
+    vector<Entry> entries;
+    vector<const void*> payloads;
+    uint64_t offset = sizeof(Header) + (spriteNames.size() + soundNames.size()) * sizeof(Entry);
+    auto place = [&offset](uint64_t size)
+    {
+        offset = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        uint64_t start = offset;
+        offset += size;
+        return start;
+    };
+    auto addEntry = [&](const string& name, uint32_t kind, uint32_t width, uint32_t height, uint32_t bits,
+                        const void* data, size_t size, const void* mipData, size_t mipSize)
+    {
+        Entry e;
+        memset(&e, 0, sizeof(e));
+        strncpy(e.name, name.c_str(), NAME_SIZE - 1);
+        e.kind = kind;
+        e.width = width;
+        e.height = height;
+        e.bits = bits;
+        e.size = size;
+        e.offset = place(size);
+        e.mipSize = mipSize;
+        e.mipOffset = (mipSize > 0 ? place(mipSize) : 0);
+        entries.push_back(e);
+        payloads.push_back(data);
+        payloads.push_back(mipData);
+    };
+    for (size_t k = 0; k < spriteNames.size(); k++)
+    {
+        if (images[k].empty())
+        {
+            log << "Cannot decode " << spriteFiles[k] << endl;
+            return false;
+        }
+        addEntry(spriteNames[k], spriteKind, images[k].width, images[k].height, 32,
+                 images[k].bgra.data(), images[k].bgra.size(), cells[k].mips.data(), cells[k].mips.size());
+    }
+    for (size_t k = 0; k < soundNames.size(); k++)
+    {
+        if (!clips[k].loadWav(assetDirectory + "/" + soundNames[k]))
+        {
+            log << "Cannot decode " << assetDirectory << "/" << soundNames[k] << endl;
+            return false;
+        }
+        addEntry(soundNames[k], soundKind, clips[k].channels, clips[k].sampleRate, clips[k].bitsPerSample,
+                 clips[k].samples(), clips[k].sampleBytes(), nullptr, 0);
+    }
+
+    ofstream out(bundleFile, ios::out|ios::binary|ios::trunc);
+    if (!out)
+    {
+        log << "Cannot create " << bundleFile << endl;
+        return false;
+    }
+    Header header;
+    copy(BUNDLE_MAGIC, BUNDLE_MAGIC + sizeof(BUNDLE_MAGIC), header.magic);
+    header.version = BUNDLE_VERSION;
+    header.count = static_cast<uint32_t>(entries.size());
+    header.reserved = 0;
+    writeValue(out, header);
+    for (const Entry& e : entries)
+        writeValue(out, e);
+    static const char zeros[ALIGNMENT] = {};
+    auto writeAt = [&out](uint64_t offset, const void* data, uint64_t size)
+    {
+        uint64_t position = static_cast<uint64_t>(out.tellp());
+        out.write(zeros, static_cast<streamsize>(offset - position));
+        out.write(static_cast<const char*>(data), static_cast<streamsize>(size));
+    };
+    for (size_t k = 0; k < entries.size(); k++)
+    {
+        writeAt(entries[k].offset, payloads[2 * k], entries[k].size);
+        if (entries[k].mipSize > 0)
+            writeAt(entries[k].mipOffset, payloads[2 * k + 1], entries[k].mipSize);
+    }
+    if (!out)
+    {
+        log << "Cannot write " << bundleFile << endl;
+        return false;
+    }
+    log << "Packed " << spriteNames.size() << " sprites and " << soundNames.size() << " sounds into "
+        << bundleFile << " (" << offset << " bytes)" << endl;
+    return true;
+}
+
+#ifdef _MSC_VER
+
+bool AssetBundle::map(const string& fileName)
+{
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER length;
+    HANDLE mapping = nullptr;
+    if (!GetFileSizeEx(file, &length)  ||  length.QuadPart == 0  ||
+        (mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (base == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_fileHandle = file;
+    m_mappingHandle = mapping;
+    m_base = static_cast<const unsigned char*>(base);
+    m_length = static_cast<size_t>(length.QuadPart);
+    return true;
+}
+
+void AssetBundle::unmap()
+{
+    if (m_base == nullptr)
+        return;
+    UnmapViewOfFile(m_base);
+    CloseHandle(m_mappingHandle);
+    CloseHandle(m_fileHandle);
+    m_base = nullptr;
+    m_length = 0;
+}
+
+#else
+
+bool AssetBundle::map(const string& fileName)
+{
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) != 0  ||  statbuf.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, static_cast<size_t>(statbuf.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // the mapping keeps the file open
+    if (base == MAP_FAILED)
+        return false;
+    m_base = static_cast<const unsigned char*>(base);
+    m_length = static_cast<size_t>(statbuf.st_size);
+    return true;
+}
+
+void AssetBundle::unmap()
+{
+    if (m_base == nullptr)
+        return;
+    munmap(const_cast<unsigned char*>(m_base), m_length);
+    m_base = nullptr;
+    m_length = 0;
+}
+
+#endif
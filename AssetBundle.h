@@ -0,0 +1,99 @@
+#ifndef ASSETBUNDLE_H_
+#define ASSETBUNDLE_H_
+
+#include "TgaImage.h"
+#include "SoundBank.h"
+#include "SpriteCell.h"
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+  // Every sprite and sound in the Assets directory packed into one file,
+  // already decoded: sprites as BGRA pixels along with the mip levels of
+  // their atlas cells, sounds as PCM samples.  A header indexes the
+  // entries by file name.  At run time the bundle is mapped into memory,
+  // and sprites and sounds are handed out as views of the mapping, so
+  // starting up costs one open and the page faults for what is actually
+  // touched.  Files are written in host byte order.
+  //
+  // Build the bundle with  kontagion --pack-assets  after changing Assets.
+
+class AssetBundle
+{
+  public:
+    AssetBundle();
+    ~AssetBundle();
+
+    bool open(const std::string& fileName);
+    void close();
+
+    bool isOpen() const
+    {
+        return m_base != nullptr;
+    }
+
+    int size() const
+    {
+        return static_cast<int>(m_entries.size());
+    }
+
+      // Views into the mapping, valid until close.  False if the bundle has
+      // no such entry of that kind.
+    bool sprite(const std::string& name, ImageView& image) const;
+    bool sound(const std::string& name, PcmClip& clip) const;
+
+      // Decode every .tga and .wav file in assetDirectory and write them to
+      // bundleFile.  Reports what was packed, or what failed, to log.
+    static bool pack(const std::string& assetDirectory, const std::string& bundleFile, std::ostream& log);
+
+      // Whether any .tga or .wav file in assetDirectory was changed after
+      // bundleFile was written, so the bundle no longer matches it.
+    static bool isOlderThan(const std::string& bundleFile, const std::string& assetDirectory);
+
+    AssetBundle(const AssetBundle&) = delete;
+    AssetBundle& operator=(const AssetBundle&) = delete;
+
+  private:
+    enum Kind : uint32_t { spriteKind = 1, soundKind = 2 };
+
+    static const size_t NAME_SIZE = 48;
+    static const size_t ALIGNMENT = 64;     // of each entry's data
+
+    struct Header
+    {
+        char     magic[4];
+        uint32_t version;
+        uint32_t count;         // entries following the header
+        uint32_t reserved;
+    };
+
+    struct Entry
+    {
+        char     name[NAME_SIZE];   // file name, NUL-padded
+        uint32_t kind;
+        uint32_t width;             // sprite: pixels; sound: channels
+        uint32_t height;            // sprite: pixels; sound: sample rate
+        uint32_t bits;              // sprite: 32; sound: bits per sample
+        uint64_t offset;            // of the data, from the start of the file
+        uint64_t size;              // of the data in bytes
+        uint64_t mipOffset;         // sprite: the reduced levels of its SpriteCell
+        uint64_t mipSize;
+    };
+
+    const unsigned char* m_base;
+    size_t               m_length;
+    std::vector<Entry>   m_entries;     // sorted by name
+#ifdef _MSC_VER
+    void*                m_fileHandle;
+    void*                m_mappingHandle;
+#endif
+
+    const Entry* find(const std::string& name, uint32_t kind) const;
+    bool validate() const;
+    bool map(const std::string& fileName);
+    void unmap();
+};
+
+#endif // ASSETBUNDLE_H_
@@ -0,0 +1,74 @@
+#include "AssetLoader.h"
+#include "AssetBundle.h"
+#include "Tracer.h"
+using namespace std;
+
+AssetLoader::AssetLoader()
+ : m_bundle(nullptr), m_completed(0), m_done(false)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+    finish();
+}
+
+void AssetLoader::addSprite(int imageID, int frameNum, const string& fileName)
+{
+    m_sprites.push_back(Sprite{ imageID, frameNum, fileName, ImageView(), TgaImage() });
+}
+
+void AssetLoader::addSound(int soundID, const string& fileName)
+{
+    m_sounds.push_back(Sound{ soundID, fileName, PcmClip() });
+}
+
+void AssetLoader::start(const string& assetPath, const AssetBundle* bundle)
+{
+    m_assetPath = assetPath;
+    m_bundle = bundle;
+    m_completed = 0;
+    m_done = false;
+    m_thread = thread(&AssetLoader::load, this);
+}
+
+void AssetLoader::finish()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void AssetLoader::load()
+{
+    Tracer::nameThread("asset loader");
+    TRACE_SCOPE("assets", "load assets");
+      // sounds first: they are few, and the welcome screen plays one
+    for (Sound& s : m_sounds)
+    {
+        TRACE_SCOPE_DETAIL("assets", "sound", s.fileName.c_str());
+        if (m_bundle == nullptr  ||  !m_bundle->sound(s.fileName, s.clip))
+            s.clip.loadWav(m_assetPath + s.fileName);
+        s.clip.path = m_assetPath + s.fileName;     // for backends that play by file name
+        m_completed++;
+    }
+
+    vector<string> files;
+    vector<Sprite*> toDecode;
+    for (Sprite& s : m_sprites)
+    {
+        if (m_bundle != nullptr  &&  m_bundle->sprite(s.fileName, s.pixels))
+            m_completed++;
+        else
+        {
+            files.push_back(m_assetPath + s.fileName);
+            toDecode.push_back(&s);
+        }
+    }
+    vector<TgaImage> images = TgaImage::loadAll(files, &m_completed);
+    for (size_t k = 0; k < images.size(); k++)
+    {
+        toDecode[k]->decoded = move(images[k]);
+        toDecode[k]->pixels = toDecode[k]->decoded.view();
+    }
+    m_done.store(true, memory_order_release);
+}
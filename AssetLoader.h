@@ -0,0 +1,93 @@
+#ifndef ASSETLOADER_H_
+#define ASSETLOADER_H_
+
+#include "TgaImage.h"
+#include "SoundBank.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+class AssetBundle;
+
+  // Gets every sprite and sound ready on a thread of its own, so the window
+  // can open and show progress meanwhile.  Frames come from the asset
+  // bundle where it has them and are otherwise decoded from their files;
+  // sounds likewise.  Nothing here touches OpenGL or the sound system: once
+  // done() says so, the owner takes the results and hands them over on the
+  // threads that own those.
+
+class AssetLoader
+{
+  public:
+    struct Sprite
+    {
+        int         imageID;
+        int         frameNum;
+        std::string fileName;
+        ImageView   pixels;     // into the bundle, or into decoded
+        TgaImage    decoded;    // empty when the bundle had the frame
+    };
+
+    struct Sound
+    {
+        int         soundID;
+        std::string fileName;
+        PcmClip     clip;       // empty if it could not be loaded
+    };
+
+    AssetLoader();
+    ~AssetLoader();
+
+      // List everything before calling start.
+    void addSprite(int imageID, int frameNum, const std::string& fileName);
+    void addSound(int soundID, const std::string& fileName);
+
+      // File names are relative to assetPath; bundle may be nullptr.
+    void start(const std::string& assetPath, const AssetBundle* bundle);
+
+    bool done() const
+    {
+        return m_done.load(std::memory_order_acquire);
+    }
+
+      // Wait for the thread; the results may be used after this.
+    void finish();
+
+      // items loaded so far, out of total()
+    int completed() const
+    {
+        return m_completed.load(std::memory_order_relaxed);
+    }
+
+    int total() const
+    {
+        return static_cast<int>(m_sprites.size() + m_sounds.size());
+    }
+
+    std::vector<Sprite>& sprites()
+    {
+        return m_sprites;
+    }
+
+    std::vector<Sound>& sounds()
+    {
+        return m_sounds;
+    }
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+  private:
+    std::vector<Sprite> m_sprites;
+    std::vector<Sound>  m_sounds;
+    std::string         m_assetPath;
+    const AssetBundle*  m_bundle;
+    std::thread         m_thread;
+    std::atomic<int>    m_completed;
+    std::atomic<bool>   m_done;
+
+    void load();
+};
+
+#endif // ASSETLOADER_H_
@@ -0,0 +1,204 @@
+#include "AudioMixer.h"
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+using namespace std;
+
+using MixClock = chrono::steady_clock;
+
+static long long nsBetween(MixClock::time_point from, MixClock::time_point to)
+{
+    return chrono::duration_cast<chrono::nanoseconds>(to - from).count();
+}
+
+AudioMixer::AudioMixer()
+ : m_accumulator(BLOCK_FRAMES * CHANNELS), m_output(BLOCK_FRAMES * CHANNELS),
+   m_voiceManager(NUM_VOICES), m_framesMixed(0), m_running(false), m_droppedCommands(0)
+{
+}
+
+AudioMixer::~AudioMixer()
+{
+    stop();
+}
+
+void AudioMixer::registerClip(int soundID, const PcmClip& clip)
+{
+    if (soundID < 0  ||  isRunning())
+        return;
+    if (soundID >= static_cast<int>(m_clips.size()))
+        m_clips.resize(soundID + 1);
+
+      // Convert to signed 16-bit stereo at the mixer's rate, resampling
+      // linearly, so mixing is nothing but additions.
+    int inFrames = clip.frameCount();
+    if (inFrames == 0)
+        return;
+    auto sampleAt = [&clip](int frame, int channel) -> int
+    {
+        int c = (clip.channels == 1 ? 0 : channel);
+        size_t index = static_cast<size_t>(frame) * clip.channels + c;
+        if (clip.bitsPerSample == 8)
+            return (static_cast<unsigned char>(clip.samples()[index]) - 128) << 8;
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(clip.samples()) + 2 * index;
+        return static_cast<int16_t>(p[0] | p[1] << 8);
+    };
+    long long outFrames = static_cast<long long>(inFrames) * SAMPLE_RATE / clip.sampleRate;
+    vector<int16_t>& out = m_clips[soundID];
+    out.resize(static_cast<size_t>(outFrames) * CHANNELS);
+    for (long long f = 0; f < outFrames; f++)
+    {
+        double source = static_cast<double>(f) * clip.sampleRate / SAMPLE_RATE;
+        int f0 = static_cast<int>(source);
+        int f1 = min(f0 + 1, inFrames - 1);
+        double t = source - f0;
+        for (int c = 0; c < CHANNELS; c++)
+            out[f * CHANNELS + c] = static_cast<int16_t>(sampleAt(f0, c) * (1 - t) + sampleAt(f1, c) * t);
+    }
+    m_voiceManager.setDuration(soundID, 1000.0 * outFrames / SAMPLE_RATE);
+}
+
+void AudioMixer::setPolicy(int soundID, const VoicePolicy& policy)
+{
+    if (!isRunning())
+        m_voiceManager.setPolicy(soundID, policy);
+}
+
+bool AudioMixer::start(unique_ptr<AudioSink> sink)
+{
+    if (isRunning()  ||  sink == nullptr  ||  !sink->isOpen())
+        return false;
+    m_sink = move(sink);
+    m_stats = AudioMixerStats();
+    m_running = true;
+    m_thread = thread(&AudioMixer::mixLoop, this);
+    return true;
+}
+
+void AudioMixer::stop()
+{
+    if (!isRunning())
+        return;
+    m_running = false;
+    m_thread.join();
+    m_stats.droppedCommands = m_droppedCommands;
+    m_sink.reset();     // closes the file, if any
+}
+
+void AudioMixer::play(int soundID)
+{
+    if (!isRunning())
+        return;
+    if (!m_commands.push(Command{ Command::play, static_cast<int16_t>(soundID) }))
+        m_droppedCommands++;
+}
+
+void AudioMixer::stopAll()
+{
+    if (!isRunning())
+        return;
+    if (!m_commands.push(Command{ Command::stopAll, -1 }))
+        m_droppedCommands++;
+}
+
+void AudioMixer::mixLoop()
+{
+    const chrono::nanoseconds blockDuration(1000000000LL * BLOCK_FRAMES / SAMPLE_RATE);
+    MixClock::time_point started = MixClock::now();
+    MixClock::time_point deadline = started;
+    while (m_running.load(memory_order_relaxed))
+    {
+        MixClock::time_point mixStart = MixClock::now();
+        runCommands();
+        mixBlock();
+        long long ns = nsBetween(mixStart, MixClock::now());
+        m_stats.blocks++;
+        m_stats.totalMixNs += ns;
+        m_stats.maxMixNs = max(m_stats.maxMixNs, ns);
+
+        m_sink->write(m_output.data(), BLOCK_FRAMES);
+
+          // Stay in step with real time; after a long stall, start afresh
+          // rather than rushing to catch up.
+        deadline += blockDuration;
+        MixClock::time_point now = MixClock::now();
+        if (now - deadline > 8 * blockDuration)
+            deadline = now;
+        this_thread::sleep_until(deadline);
+    }
+    m_stats.wallNs = nsBetween(started, MixClock::now());
+}
+
+void AudioMixer::runCommands()
+{
+    Command command;
+    while (m_commands.pop(command))
+    {
+        if (command.type == Command::stopAll)
+        {
+            for (Voice& v : m_voices)
+                v.clip = -1;
+            m_voiceManager.releaseAll();
+        }
+        else
+            startVoice(command.soundID);
+    }
+}
+
+void AudioMixer::startVoice(int soundID)
+{
+    if (soundID < 0  ||  soundID >= static_cast<int>(m_clips.size())  ||  m_clips[soundID].empty())
+        return;
+
+      // Time is measured in mixed frames, so the decision doesn't depend on
+      // how promptly this thread was scheduled.  A stolen voice is simply
+      // restarted with the new clip.
+    bool stolen;
+    int v = m_voiceManager.acquire(soundID, 1000.0 * m_framesMixed / SAMPLE_RATE, stolen);
+    if (v == VoiceManager::NO_VOICE)
+    {
+        m_stats.droppedPlays++;
+        return;
+    }
+    m_voices[v].clip = soundID;
+    m_voices[v].position = 0;
+}
+
+void AudioMixer::mixBlock()
+{
+    fill(m_accumulator.begin(), m_accumulator.end(), 0);
+    int active = 0;
+    for (Voice& v : m_voices)
+    {
+        if (v.clip < 0)
+            continue;
+        active++;
+        const vector<int16_t>& samples = m_clips[v.clip];
+        int clipFrames = static_cast<int>(samples.size()) / CHANNELS;
+        int frames = min(BLOCK_FRAMES, clipFrames - v.position);
+        const int16_t* in = samples.data() + static_cast<size_t>(v.position) * CHANNELS;
+        int32_t* acc = m_accumulator.data();
+        for (int k = 0; k < frames * CHANNELS; k++)
+            acc[k] += in[k];
+        v.position += frames;
+        if (v.position >= clipFrames)
+            v.clip = -1;
+    }
+    m_stats.maxActiveVoices = max(m_stats.maxActiveVoices, active);
+    m_framesMixed += BLOCK_FRAMES;
+
+    for (int k = 0; k < BLOCK_FRAMES * CHANNELS; k++)
+        m_output[k] = static_cast<int16_t>(max(-32768, min(32767, m_accumulator[k])));
+}
+
+void AudioMixer::printStats(ostream& os) const
+{
+    double avgUs = (m_stats.blocks > 0 ? m_stats.totalMixNs / 1000.0 / m_stats.blocks : 0);
+    os << fixed << setprecision(2)
+       << "Audio: " << m_stats.blocks << " blocks of " << BLOCK_FRAMES << " frames; mix avg "
+       << avgUs << " us, max " << m_stats.maxMixNs / 1000.0 << " us; "
+       << m_stats.cpuPercent() << "% of one core; up to " << m_stats.maxActiveVoices
+       << " voices; " << m_stats.droppedPlays << " plays and " << m_stats.droppedCommands
+       << " commands dropped" << endl;
+    m_voiceManager.stats().print(os);
+}
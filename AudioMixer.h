@@ -0,0 +1,114 @@
+#ifndef AUDIOMIXER_H_
+#define AUDIOMIXER_H_
+
+#include "SoundBank.h"
+#include "AudioSink.h"
+#include "SpscRing.h"
+#include "VoiceManager.h"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <ostream>
+#include <cstdint>
+
+struct AudioMixerStats
+{
+    long long blocks = 0;
+    long long totalMixNs = 0;       // time spent mixing, excluding the sink
+    long long maxMixNs = 0;
+    long long wallNs = 0;           // time the mixing thread has been running
+    long long droppedCommands = 0;  // ring full
+    long long droppedPlays = 0;     // refused by the voice manager
+    int       maxActiveVoices = 0;
+
+    double cpuPercent() const
+    {
+        return wallNs > 0 ? 100.0 * totalMixNs / wallNs : 0;
+    }
+};
+
+  // Real-time software mixer with a fixed pool of voices.  Clips are
+  // converted to the output format when registered.  The game thread
+  // submits play and stop commands through a lock-free ring, so it never
+  // blocks; a dedicated thread drains the ring, mixes one block at a time
+  // and hands it to the sink, paced to real time.
+
+class AudioMixer
+{
+  public:
+    static const int SAMPLE_RATE = 44100;
+    static const int CHANNELS = 2;
+    static const int BLOCK_FRAMES = 512;
+    static const int NUM_VOICES = 32;
+
+    AudioMixer();
+    ~AudioMixer();
+
+      // Only before start(): the clip and policy tables are read by the
+      // mixing thread.
+    void registerClip(int soundID, const PcmClip& clip);
+    void setPolicy(int soundID, const VoicePolicy& policy);
+
+    bool start(std::unique_ptr<AudioSink> sink);
+    void stop();
+
+    bool isRunning() const
+    {
+        return m_running.load(std::memory_order_relaxed);
+    }
+
+      // Game thread
+    void play(int soundID);
+    void stopAll();
+
+      // Complete once stop() has returned.
+    const AudioMixerStats& stats() const
+    {
+        return m_stats;
+    }
+
+    const VoiceStats& voiceStats() const
+    {
+        return m_voiceManager.stats();
+    }
+
+    void printStats(std::ostream& os) const;
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+  private:
+    struct Command
+    {
+        enum Type : uint8_t { play, stopAll };
+        Type    type;
+        int16_t soundID;
+    };
+
+    struct Voice
+    {
+        int clip = -1;          // sound ID, or -1 when free
+        int position = 0;       // next frame to mix
+    };
+
+    std::vector<std::vector<int16_t>> m_clips;     // interleaved stereo, by sound ID
+    SpscRing<Command, 256>            m_commands;
+    Voice                             m_voices[NUM_VOICES];
+    std::vector<int32_t>              m_accumulator;
+    std::vector<int16_t>              m_output;
+    VoiceManager                      m_voiceManager;
+    long long                         m_framesMixed;
+    std::unique_ptr<AudioSink>        m_sink;
+    std::thread                       m_thread;
+    std::atomic<bool>                 m_running;
+    std::atomic<long long>            m_droppedCommands;
+    AudioMixerStats                   m_stats;
+
+    void mixLoop();
+    void runCommands();
+    void startVoice(int soundID);
+    void mixBlock();
+};
+
+#endif // AUDIOMIXER_H_
@@ -0,0 +1,118 @@
+#ifndef AUDIOSINK_H_
+#define AUDIOSINK_H_
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+  // Where the software mixer sends its output: interleaved signed 16-bit
+  // stereo frames at the mixer's sample rate, one block at a time, always
+  // from the mixing thread.
+
+class AudioSink
+{
+  public:
+    virtual ~AudioSink()
+    {
+    }
+
+    virtual bool isOpen() const = 0;
+    virtual void write(const int16_t* frames, int frameCount) = 0;
+};
+
+  // Discards the output.  The mixer still runs in real time, so its cost
+  // can be measured on machines without an audio device.
+
+class NullAudioSink : public AudioSink
+{
+  public:
+    virtual bool isOpen() const
+    {
+        return true;
+    }
+
+    virtual void write(const int16_t*, int)
+    {
+    }
+};
+
+  // Writes the output to a WAV file for offline verification.  The header's
+  // sizes are filled in when the sink is destroyed.
+
+class WavFileAudioSink : public AudioSink
+{
+  public:
+    WavFileAudioSink(const std::string& fileName, int sampleRate)
+     : m_file(fileName, std::ios::out|std::ios::binary|std::ios::trunc),
+       m_sampleRate(sampleRate), m_dataBytes(0)
+    {
+        if (m_file)
+            writeHeader();
+    }
+
+    virtual ~WavFileAudioSink()
+    {
+        if (m_file)
+        {
+            m_file.seekp(0);
+            writeHeader();
+        }
+    }
+
+    virtual bool isOpen() const
+    {
+        return static_cast<bool>(m_file);
+    }
+
+    virtual void write(const int16_t* frames, int frameCount)
+    {
+        m_bytes.resize(static_cast<size_t>(frameCount) * CHANNELS * 2);
+        for (int k = 0; k < frameCount * CHANNELS; k++)
+        {
+            uint16_t v = static_cast<uint16_t>(frames[k]);
+            m_bytes[2*k] = static_cast<char>(v & 0xff);
+            m_bytes[2*k+1] = static_cast<char>(v >> 8);
+        }
+        m_file.write(m_bytes.data(), m_bytes.size());
+        m_dataBytes += static_cast<uint32_t>(m_bytes.size());
+    }
+
+  private:
+    static const int CHANNELS = 2;
+
+    std::ofstream m_file;
+    int           m_sampleRate;
+    uint32_t      m_dataBytes;
+    std::vector<char> m_bytes;   // one block, little-endian
+
+    void writeHeader()
+    {
+        m_file.write("RIFF", 4);
+        writeLE32(36 + m_dataBytes);
+        m_file.write("WAVEfmt ", 8);
+        writeLE32(16);
+        writeLE16(1);                                   // PCM
+        writeLE16(CHANNELS);
+        writeLE32(static_cast<uint32_t>(m_sampleRate));
+        writeLE32(static_cast<uint32_t>(m_sampleRate) * CHANNELS * 2);
+        writeLE16(CHANNELS * 2);                        // bytes per frame
+        writeLE16(16);                                  // bits per sample
+        m_file.write("data", 4);
+        writeLE32(m_dataBytes);
+    }
+
+    void writeLE16(uint16_t v)
+    {
+        char b[2] = { static_cast<char>(v & 0xff), static_cast<char>(v >> 8) };
+        m_file.write(b, 2);
+    }
+
+    void writeLE32(uint32_t v)
+    {
+        writeLE16(static_cast<uint16_t>(v & 0xffff));
+        writeLE16(static_cast<uint16_t>(v >> 16));
+    }
+};
+
+#endif // AUDIOSINK_H_
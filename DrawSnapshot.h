@@ -0,0 +1,75 @@
+#ifndef DRAWSNAPSHOT_H_
+#define DRAWSNAPSHOT_H_
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+  // Everything needed to draw one frame, captured on the simulation side at
+  // the end of a tick so the renderer never touches live GraphObjects.
+
+struct DrawItem
+{
+    int32_t imageID;
+    int32_t animationNumber;  // reduced to a frame by the sprite manager
+    float   x;                // simulated position at the end of the tick
+    float   y;
+    float   fromX;            // position at the start of the tick
+    float   fromY;
+    int16_t direction;
+    int16_t depth;
+    float   size;
+
+      // Where to draw the item a fraction alpha of a tick past the snapshot:
+      // interpolation trails the simulation by up to a tick, extrapolation
+      // carries the tick's motion on past the simulated position.
+    void position(double alpha, bool extrapolate, double& outX, double& outY) const
+    {
+        if (extrapolate)
+        {
+            outX = x + (x - fromX) * alpha;
+            outY = y + (y - fromY) * alpha;
+        }
+        else
+        {
+            outX = fromX + (x - fromX) * alpha;
+            outY = fromY + (y - fromY) * alpha;
+        }
+    }
+};
+
+struct DrawSnapshot
+{
+    enum Kind { none, gameplay, prompt };
+
+    using Clock = std::chrono::steady_clock;
+
+    Kind                  kind = none;
+    uint64_t              sequence = 0;
+    uint64_t              ticks = 0;     // simulation ticks run before it was published
+    std::vector<DrawItem> items;         // back to front
+    std::vector<DrawItem> staticItems;   // drawn beneath items, from a cache
+    uint64_t              staticVersion = 0;
+    std::string           statText;
+    uint64_t              statVersion = 0;   // changes whenever statText does
+    std::string           mainMessage;
+    std::string           secondMessage;
+
+      // For blending between ticks: the fraction of a tick already banked
+      // when the snapshot was published, and the tick rate to advance it by.
+    Clock::time_point     published;
+    double                alpha = 1;
+    double                ticksPerMs = 0;  // 0 means hold alpha as is
+    bool                  extrapolate = false;
+
+    double alphaAt(Clock::time_point now) const
+    {
+        double a = alpha;
+        if (ticksPerMs > 0)
+            a += std::chrono::duration<double, std::milli>(now - published).count() * ticksPerMs;
+        return a < 0 ? 0 : (a > 1 ? 1 : a);
+    }
+};
+
+#endif // DRAWSNAPSHOT_H_
@@ -0,0 +1,190 @@
+#ifndef FIXEDTIMESTEP_H_
+#define FIXEDTIMESTEP_H_
+
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <iomanip>
+
+  // Decouples the simulation tick rate from the display rate.  Each displayed
+  // frame banks the wall clock time since the previous one (scaled by the
+  // turbo multiplier) and runs one tick per whole tick interval banked, up
+  // to a per-frame cap so that a slow stretch cannot snowball into ever
+  // longer catch-up frames.  A turbo multiplier of 0 means uncapped: ticks
+  // run back to back until the frame's time budget is spent.
+
+struct PacingStats
+{
+    long long frames = 0;
+    long long ticks = 0;
+    long long droppedTicks = 0;     // backlog discarded because of the cap
+    int       maxTicksInFrame = 0;
+    double    totalFrameMs = 0;     // sum of intervals between frames
+    double    maxFrameMs = 0;
+    double    totalTickMs = 0;      // time spent inside ticks
+    double    maxTickMs = 0;
+
+    double averageFrameMs() const
+    {
+        return frames > 1 ? totalFrameMs / (frames - 1) : 0;
+    }
+
+    double averageTickMs() const
+    {
+        return ticks > 0 ? totalTickMs / ticks : 0;
+    }
+};
+
+class FixedTimestep
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr double UNCAPPED_FRAME_BUDGET_MS = 16;
+
+    FixedTimestep(double msPerTick = 15, double turbo = 1, int maxCatchUpTicks = 5)
+    {
+        configure(msPerTick, turbo, maxCatchUpTicks);
+        reset();
+    }
+
+    void configure(double msPerTick, double turbo, int maxCatchUpTicks)
+    {
+        m_msPerTick = (msPerTick > 0 ? msPerTick : 1);
+        m_turbo = (turbo > 0 ? turbo : 0);
+        m_maxCatchUpTicks = (maxCatchUpTicks > 0 ? maxCatchUpTicks : 1);
+    }
+
+      // Forget any banked time, e.g. after a prompt or while single-stepping.
+    void reset()
+    {
+        m_accumulatedMs = 0;
+        m_lastFrame = Clock::now();
+        m_frameStart = m_lastFrame;
+        m_havePreviousFrame = false;
+        m_ticksThisFrame = 0;
+    }
+
+    void beginFrame()
+    {
+        Clock::time_point now = Clock::now();
+        double elapsedMs = msBetween(m_lastFrame, now);
+        m_lastFrame = now;
+        m_frameStart = now;
+        m_ticksThisFrame = 0;
+        if (m_havePreviousFrame)
+        {
+            m_stats.totalFrameMs += elapsedMs;
+            if (elapsedMs > m_stats.maxFrameMs)
+                m_stats.maxFrameMs = elapsedMs;
+        }
+        m_havePreviousFrame = true;
+        m_stats.frames++;
+        if (m_turbo > 0)
+            m_accumulatedMs += elapsedMs * m_turbo;
+    }
+
+      // Whether another tick should run in this frame.  Each true return
+      // consumes one tick interval from the bank.
+    bool shouldTick()
+    {
+        if (m_turbo == 0)
+        {
+            if (msBetween(m_frameStart, Clock::now()) >= UNCAPPED_FRAME_BUDGET_MS)
+                return false;
+        }
+        else
+        {
+            if (m_accumulatedMs < m_msPerTick  ||  m_ticksThisFrame >= maxTicksPerFrame())
+                return false;
+            m_accumulatedMs -= m_msPerTick;
+        }
+        m_ticksThisFrame++;
+        m_tickStart = Clock::now();
+        return true;
+    }
+
+      // Called after each tick that shouldTick allowed.
+    void tickDone()
+    {
+        double ms = msBetween(m_tickStart, Clock::now());
+        m_stats.ticks++;
+        m_stats.totalTickMs += ms;
+        if (ms > m_stats.maxTickMs)
+            m_stats.maxTickMs = ms;
+    }
+
+    void endFrame()
+    {
+        if (m_ticksThisFrame > m_stats.maxTicksInFrame)
+            m_stats.maxTicksInFrame = m_ticksThisFrame;
+          // Hit the cap: drop the backlog rather than carrying it forward.
+          // A frame that stopped short of the cap (the level ended, say)
+          // keeps its banked time.
+        if (m_ticksThisFrame >= maxTicksPerFrame()  &&  m_accumulatedMs >= m_msPerTick)
+        {
+            double whole = std::floor(m_accumulatedMs / m_msPerTick);
+            m_stats.droppedTicks += static_cast<long long>(whole);
+            m_accumulatedMs -= whole * m_msPerTick;
+        }
+    }
+
+      // Fraction of a tick interval banked but not yet simulated.
+    double alpha() const
+    {
+        return m_turbo == 0 ? 1 : m_accumulatedMs / m_msPerTick;
+    }
+
+      // How fast alpha grows with wall clock time; 0 when uncapped.
+    double ticksPerMs() const
+    {
+        return m_turbo / m_msPerTick;
+    }
+
+      // Wall clock time until the next tick is due.
+    double msUntilNextTick() const
+    {
+        if (m_turbo == 0  ||  m_accumulatedMs >= m_msPerTick)
+            return 0;
+        return (m_msPerTick - m_accumulatedMs) / m_turbo;
+    }
+
+    const PacingStats& stats() const
+    {
+        return m_stats;
+    }
+
+    void printStats(std::ostream& os) const
+    {
+        os << std::fixed << std::setprecision(2)
+           << "Pacing: " << m_stats.frames << " frames, " << m_stats.ticks << " ticks, "
+           << m_stats.droppedTicks << " dropped; frame avg " << m_stats.averageFrameMs()
+           << " ms max " << m_stats.maxFrameMs << " ms; tick avg " << m_stats.averageTickMs()
+           << " ms max " << m_stats.maxTickMs << " ms; at most "
+           << m_stats.maxTicksInFrame << " ticks per frame" << std::endl;
+    }
+
+  private:
+    double m_msPerTick;
+    double m_turbo;
+    int    m_maxCatchUpTicks;
+    double m_accumulatedMs;
+    bool   m_havePreviousFrame;
+    int    m_ticksThisFrame;
+    Clock::time_point m_lastFrame;
+    Clock::time_point m_frameStart;
+    Clock::time_point m_tickStart;
+    PacingStats m_stats;
+
+    int maxTicksPerFrame() const
+    {
+        return static_cast<int>(std::ceil(m_maxCatchUpTicks * (m_turbo > 1 ? m_turbo : 1)));
+    }
+
+    static double msBetween(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+};
+
+#endif // FIXEDTIMESTEP_H_
@@ -0,0 +1,201 @@
+#include "FrameCapture.h"
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <cmath>
+using namespace std;
+
+void FrameCaptureStats::print(ostream& os) const
+{
+    double avgMs = (frames > 0 ? writeNs / 1e6 / frames : 0);
+    os << fixed << setprecision(2)
+       << "Capture: " << frames << " frames written, " << repeatedFrames << " repeated to fill gaps, "
+       << earlyFrames << " early and left out, " << droppedFrames << " dropped; write avg "
+       << avgMs << " ms, max " << maxWriteNs / 1e6 << " ms; up to " << maxQueued << " queued" << endl;
+}
+
+FrameCapture::FrameCapture()
+ : m_acquired(-1), m_droppedFrames(0), m_queued(0), m_width(0), m_height(0), m_fpsNum(1), m_fpsDen(1),
+   m_running(false)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+    close();
+}
+
+bool FrameCapture::open(const string& fileName, int width, int height, int fpsNum, int fpsDen)
+{
+    if (isOpen()  ||  width <= 0  ||  height <= 0  ||  width % 2 != 0  ||  height % 2 != 0)
+        return false;
+    {
+        ofstream probe(fileName, ios::out|ios::binary|ios::trunc);
+        if (!probe)
+            return false;
+    }
+    m_fileName = fileName;
+    m_width = width;
+    m_height = height;
+    m_fpsNum = fpsNum;
+    m_fpsDen = fpsDen;
+      // C420jpeg: full-range BT.601, chroma sited between the luma samples
+    m_header = "YUV4MPEG2 W" + to_string(width) + " H" + to_string(height) + " F" + to_string(fpsNum) +
+               ":" + to_string(fpsDen) + " Ip A1:1 C420jpeg\n";
+
+    m_buffers.assign(NUM_BUFFERS, vector<uint8_t>(static_cast<size_t>(width) * height * 4));
+    for (int b = 0; b < NUM_BUFFERS; b++)
+        m_free.push(b);
+    m_acquired = -1;
+    m_droppedFrames = 0;
+    m_queued = 0;
+    m_stats = FrameCaptureStats();
+    m_opened = Clock::now();
+    m_running = true;
+    m_thread = thread(&FrameCapture::writeLoop, this);
+    return true;
+}
+
+void FrameCapture::close()
+{
+    if (!isOpen())
+        return;
+    m_running = false;
+    m_wake.notify_one();
+    m_thread.join();
+    m_stats.droppedFrames = m_droppedFrames;
+    m_buffers.clear();
+    int b;
+    while (m_free.pop(b))
+        ;
+}
+
+double FrameCapture::msSinceOpen() const
+{
+    return chrono::duration<double, milli>(Clock::now() - m_opened).count();
+}
+
+uint8_t* FrameCapture::acquire()
+{
+    if (!isOpen())
+        return nullptr;
+    if (m_acquired < 0  &&  !m_free.pop(m_acquired))
+    {
+        m_acquired = -1;
+        m_droppedFrames++;
+        return nullptr;
+    }
+    return m_buffers[m_acquired].data();
+}
+
+void FrameCapture::submit(bool bottomRowFirst, double timeMs)
+{
+    if (m_acquired < 0)
+        return;
+    m_filled.push(Frame{ m_acquired, bottomRowFirst, timeMs });    // never full: only NUM_BUFFERS exist
+    m_acquired = -1;
+    m_queued++;
+    m_wake.notify_one();
+}
+
+void FrameCapture::writeLoop()
+{
+    ofstream out(m_fileName, ios::out|ios::binary|ios::trunc);
+    out.write(m_header.data(), m_header.size());
+
+    int w = m_width, h = m_height;
+    vector<uint8_t> yuv(static_cast<size_t>(w) * h * 3 / 2);
+    uint8_t* yPlane = yuv.data();
+    uint8_t* uPlane = yPlane + static_cast<size_t>(w) * h;
+    uint8_t* vPlane = uPlane + static_cast<size_t>(w / 2) * (h / 2);
+    long long written = 0;      // stream frames so far, repeats included
+    auto writeFrame = [&out, &yuv]()
+    {
+        out.write("FRAME\n", 6);
+        out.write(reinterpret_cast<const char*>(yuv.data()), yuv.size());
+    };
+
+    for (;;)
+    {
+        Frame frame;
+        if (!m_filled.pop(frame))
+        {
+            if (!m_running.load())
+                break;
+            unique_lock<mutex> lock(m_wakeMutex);
+            m_wake.wait_for(lock, chrono::milliseconds(5));   // the game thread never takes the lock
+            continue;
+        }
+        m_stats.maxQueued = max(m_stats.maxQueued, m_queued.load());
+        Clock::time_point start = Clock::now();
+
+          // the slot for when this frame was shown; if that is already
+          // filled, the frame came early and is left out
+        long long slot = llround(frame.timeMs * m_fpsNum / (1000.0 * m_fpsDen));
+        if (slot < written)
+        {
+            m_free.push(frame.buffer);
+            m_queued--;
+            m_stats.earlyFrames++;
+            continue;
+        }
+          // the frame written last stayed on screen until this one
+        if (written > 0)
+        {
+            for (; written < slot; written++)
+            {
+                writeFrame();
+                m_stats.repeatedFrames++;
+            }
+        }
+
+        const uint8_t* rgba = m_buffers[frame.buffer].data();
+        auto row = [rgba, w, h, &frame](int y) -> const uint8_t*
+        {
+            return rgba + static_cast<size_t>(frame.bottomRowFirst ? h - 1 - y : y) * w * 4;
+        };
+        for (int y = 0; y < h; y += 2)
+        {
+            const uint8_t* r0 = row(y);
+            const uint8_t* r1 = row(y + 1);
+            uint8_t* y0 = yPlane + static_cast<size_t>(y) * w;
+            uint8_t* y1 = y0 + w;
+            uint8_t* u = uPlane + static_cast<size_t>(y / 2) * (w / 2);
+            uint8_t* v = vPlane + static_cast<size_t>(y / 2) * (w / 2);
+            for (int x = 0; x < w; x += 2)
+            {
+                int sumR = 0, sumG = 0, sumB = 0;
+                const uint8_t* p[4] = { r0 + 4 * x, r0 + 4 * x + 4, r1 + 4 * x, r1 + 4 * x + 4 };
+                uint8_t* luma[4] = { y0 + x, y0 + x + 1, y1 + x, y1 + x + 1 };
+                for (int k = 0; k < 4; k++)
+                {
+                    int r = p[k][0], g = p[k][1], b = p[k][2];
+                    *luma[k] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+                    sumR += r;
+                    sumG += g;
+                    sumB += b;
+                }
+                int cb = ((-43 * sumR - 85 * sumG + 128 * sumB) / 4 + 128) / 256 + 128;
+                int cr = ((128 * sumR - 107 * sumG - 21 * sumB) / 4 + 128) / 256 + 128;
+                u[x / 2] = static_cast<uint8_t>(min(255, max(0, cb)));
+                v[x / 2] = static_cast<uint8_t>(min(255, max(0, cr)));
+            }
+        }
+          // the pixels are copied out, so the buffer can go back already
+        m_free.push(frame.buffer);
+        m_queued--;
+
+          // the first frame also stands in for the slots before it
+        long long copies = slot + 1 - written;
+        for (long long c = 0; c < copies; c++)
+            writeFrame();
+        m_stats.repeatedFrames += copies - 1;
+        written = slot + 1;
+
+        long long ns = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+        m_stats.frames++;
+        m_stats.writeNs += ns;
+        m_stats.maxWriteNs = max(m_stats.maxWriteNs, ns);
+    }
+}
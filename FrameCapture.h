@@ -0,0 +1,125 @@
+#ifndef FRAMECAPTURE_H_
+#define FRAMECAPTURE_H_
+
+#include "SpscRing.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+#include <cstdint>
+
+struct FrameCaptureStats
+{
+    long long frames = 0;           // written to the stream, once each
+    long long repeatedFrames = 0;   // extra copies written to fill gaps
+    long long earlyFrames = 0;      // not written: their slot was already filled
+    long long droppedFrames = 0;    // never captured: no buffer free, or the window the wrong size
+    long long writeNs = 0;          // converting and writing, on the writer thread
+    long long maxWriteNs = 0;
+    int       maxQueued = 0;
+
+    void print(std::ostream& os) const;
+};
+
+  // Records displayed frames as a YUV4MPEG2 (Y4M) stream.  The game thread
+  // copies each frame's RGBA pixels into one of a fixed pool of buffers and
+  // hands it over through a lock-free ring; a writer thread converts it to
+  // 4:2:0 YUV and writes it out.  When the writer falls behind and no buffer
+  // is free, the frame is dropped and counted rather than waited for, so
+  // recording never stalls the game.
+  //
+  // The stream has a constant rate, but frames don't arrive at one, so each
+  // comes with the time it was shown and goes out in the slot for that
+  // time: frame n of the stream is what was on screen at n / rate.  The
+  // last frame is repeated across any gap (a dropped frame, a late one), and
+  // a frame whose slot is already filled is left out, so the video keeps
+  // time with the game and with an audio capture made alongside it.
+
+class FrameCapture
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static const int NUM_BUFFERS = 8;
+
+    FrameCapture();
+    ~FrameCapture();
+
+      // width and height must be even; the rate is fpsNum/fpsDen frames a second.
+    bool open(const std::string& fileName, int width, int height, int fpsNum, int fpsDen);
+    void close();
+
+    bool isOpen() const
+    {
+        return m_running.load(std::memory_order_relaxed);
+    }
+
+    int width() const
+    {
+        return m_width;
+    }
+
+    int height() const
+    {
+        return m_height;
+    }
+
+      // Game thread: a buffer of width * height RGBA pixels to fill, or
+      // nullptr if the frame must be dropped.  Pass it to submit once full,
+      // with when it was shown, in milliseconds since the stream's start.
+    uint8_t* acquire();
+    void submit(bool bottomRowFirst, double timeMs);
+
+      // Game thread: a frame was shown but can't be captured.
+    void drop()
+    {
+        m_droppedFrames++;
+    }
+
+      // Wall clock milliseconds since open.
+    double msSinceOpen() const;
+
+      // Complete once close() has returned.
+    const FrameCaptureStats& stats() const
+    {
+        return m_stats;
+    }
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+  private:
+    struct Frame
+    {
+        int    buffer;
+        bool   bottomRowFirst;
+        double timeMs;
+    };
+
+    std::vector<std::vector<uint8_t>> m_buffers;
+    SpscRing<int, 16>       m_free;         // writer -> game
+    SpscRing<Frame, 16>     m_filled;       // game -> writer
+    int                     m_acquired;     // buffer the game thread is filling, or -1
+    std::atomic<long long>  m_droppedFrames;
+    std::atomic<int>        m_queued;
+    int                     m_width;
+    int                     m_height;
+    int                     m_fpsNum;
+    int                     m_fpsDen;
+    Clock::time_point       m_opened;
+    std::string             m_header;
+    std::string             m_fileName;
+    std::thread             m_thread;
+    std::atomic<bool>       m_running;
+    std::mutex              m_wakeMutex;
+    std::condition_variable m_wake;
+    FrameCaptureStats       m_stats;
+
+    void writeLoop();
+};
+
+#endif // FRAMECAPTURE_H_
@@ -0,0 +1,223 @@
+#ifndef FRAMESCHEDULER_H_
+#define FRAMESCHEDULER_H_
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+
+struct FrameStats
+{
+    long long frames = 0;
+    long long overruns = 0;         // work took longer than the frame deadline
+    long long resyncs = 0;          // fell a whole frame behind; the schedule restarted
+    long long unchanged = 0;        // nothing new to draw, so nothing was
+    long long idles = 0;            // times the schedule stopped to wait for a key
+    double    totalWorkMs = 0;
+    double    maxWorkMs = 0;
+    double    maxLateMs = 0;        // a frame's start past its due time
+
+    void print(std::ostream& os, double frameMs) const
+    {
+        os << std::fixed << std::setprecision(2)
+           << "Frames: " << frames << " due every " << frameMs << " ms; work avg "
+           << (frames > 0 ? totalWorkMs / frames : 0) << " ms max " << maxWorkMs << " ms, "
+           << overruns << " overran; started up to " << maxLateMs << " ms late, "
+           << resyncs << " resyncs; " << unchanged << " unchanged, " << idles << " idles" << std::endl;
+    }
+};
+
+  // Paces frames to a deadline.  Each frame is due one frame interval after
+  // the previous one was due, not after it finished, so the time a frame
+  // takes comes out of the wait before the next instead of adding to it,
+  // and the rate does not drift under load.  A frame that overruns makes
+  // the next one due at once; falling a whole interval behind restarts the
+  // schedule from now rather than bursting to catch up.
+  //
+  // The wait is an ordinary sleep for all but its last SPIN_MS, which is
+  // spent yielding, because sleeps can overshoot by a scheduler quantum.
+  //
+  // When the screen shows something that cannot change until a key
+  // arrives, the owner stops the schedule with idle(), and restarts it with
+  // wake() when a key comes.
+
+class FrameScheduler
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr double SPIN_MS = 0.25;
+
+    FrameScheduler(double frameMs = 5)
+    {
+        configure(frameMs);
+        reset();
+    }
+
+    void configure(double frameMs)
+    {
+        m_frameMs = (frameMs > 0 ? frameMs : 1);
+    }
+
+    double frameMs() const
+    {
+        return m_frameMs;
+    }
+
+      // The next frame is due now.
+    void reset()
+    {
+        m_due = Clock::now();
+        m_idle = false;
+    }
+
+      // Make the next frame due within ms, if it is not already.
+    void dueWithin(double ms)
+    {
+        m_due = std::min(m_due, Clock::now() + toDuration(std::max(ms, 0.0)));
+    }
+
+    double msUntilDue() const
+    {
+        return msBetween(Clock::now(), m_due);
+    }
+
+      // For timers with whole milliseconds: the most that can be waited
+      // without passing the due time.
+    unsigned wholeMsUntilDue() const
+    {
+        double ms = msUntilDue();
+        return ms > 0 ? static_cast<unsigned>(ms) : 0;
+    }
+
+    void waitUntilDue() const
+    {
+        sleepUntil(m_due);
+    }
+
+    void beginFrame()
+    {
+        m_frameStart = Clock::now();
+        m_stats.maxLateMs = std::max(m_stats.maxLateMs, msBetween(m_due, m_frameStart));
+    }
+
+    void endFrame()
+    {
+        Clock::time_point now = Clock::now();
+        double workMs = msBetween(m_frameStart, now);
+        m_stats.frames++;
+        m_stats.totalWorkMs += workMs;
+        m_stats.maxWorkMs = std::max(m_stats.maxWorkMs, workMs);
+        if (workMs > m_frameMs)
+            m_stats.overruns++;
+
+        m_due += toDuration(m_frameMs);
+        if (msBetween(m_due, now) >= m_frameMs)
+        {
+            m_due = now;
+            m_stats.resyncs++;
+        }
+    }
+
+      // The frame just ended found nothing new to draw.
+    void noteUnchanged()
+    {
+        m_stats.unchanged++;
+    }
+
+    void idle()
+    {
+        m_idle = true;
+        m_stats.idles++;
+    }
+
+    bool isIdle() const
+    {
+        return m_idle;
+    }
+
+      // Whether the schedule was idle; if so, it restarts with a frame due now.
+    bool wake()
+    {
+        if (!m_idle)
+            return false;
+        reset();
+        return true;
+    }
+
+    const FrameStats& stats() const
+    {
+        return m_stats;
+    }
+
+    void printStats(std::ostream& os) const
+    {
+        m_stats.print(os, m_frameMs);
+    }
+
+      // Sleep for ms, to within a fraction of a millisecond.
+    static void sleepFor(double ms)
+    {
+        sleepUntil(Clock::now() + toDuration(std::max(ms, 0.0)));
+    }
+
+    static void sleepUntil(Clock::time_point when)
+    {
+        double ms = msBetween(Clock::now(), when);
+        if (ms > SPIN_MS)
+            std::this_thread::sleep_for(toDuration(ms - SPIN_MS));
+        while (Clock::now() < when)
+            std::this_thread::yield();
+    }
+
+  private:
+    double            m_frameMs;
+    bool              m_idle;
+    Clock::time_point m_due;
+    Clock::time_point m_frameStart;
+    FrameStats        m_stats;
+
+    static Clock::duration toDuration(double ms)
+    {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(ms));
+    }
+
+    static double msBetween(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+};
+
+  // A wakeup for a thread with nothing to do until some other thread has
+  // something for it.  A raise that comes before the wait is not lost; it
+  // makes the wait return at once.
+
+class WakeSignal
+{
+  public:
+    void raise()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_raised = true;
+        }
+        m_condition.notify_one();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_raised; });
+        m_raised = false;
+    }
+
+  private:
+    std::mutex              m_mutex;
+    std::condition_variable m_condition;
+    bool                    m_raised = false;
+};
+
+#endif // FRAMESCHEDULER_H_
@@ -71,6 +71,23 @@ const int GWSTATUS_FINISHED_LEVEL = 3;
 const int GWSTATUS_LEVEL_ERROR    = 4;
 
 
+  // The generator behind randInt.  It is seeded randomly unless seedRandom
+  // is called, which replays rely on to reproduce a session exactly.
+
+inline
+std::default_random_engine& randomEngine()
+{
+    static std::random_device rd;
+    static std::default_random_engine generator(rd());
+    return generator;
+}
+
+inline
+void seedRandom(unsigned int seed)
+{
+    randomEngine().seed(seed);
+}
+
   // Return a uniformly distributed random int from min to max, inclusive
 
 inline
@@ -78,10 +95,8 @@ int randInt(int min, int max)
 {
     if (max < min)
         std::swap(max, min);
-    static std::random_device rd;
-    static std::default_random_engine generator(rd());
     std::uniform_int_distribution<> distro(min, max);
-    return distro(generator);
+    return distro(randomEngine());
 }
 
 #endif // GAMECONSTANTS_H_
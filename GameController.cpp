@@ -5,13 +5,26 @@
 #include "GraphObject.h"
 #include "SoundFX.h"
 #include "SpriteManager.h"
+#include "TickProfiler.h"
+#include "ActorAccounting.h"
+#include "Tracer.h"
 #include <string>
 #include <map>
 #include <utility>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
 #include <cstdlib>
 #include <algorithm>
+#include <random>
+#include <chrono>
 using namespace std;
 
+#ifdef _MSC_VER
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
 /*
 spriteWidth = .67
 spritesPerRow = 16
@@ -41,8 +54,6 @@ static const double FONT_SCALEDOWN = 760.0;
 static const double SCORE_Y = 3.8;
 static const double SCORE_Z = -10;
 
-static const int MS_PER_FRAME = 5;
-
 struct SpriteInfo
 {
     int         imageID;
@@ -51,14 +62,18 @@ struct SpriteInfo
 };
 
 static void drawPrompt(string mainMessage, string secondMessage);
-static void drawScoreAndLives(string);
 
 enum GameController::GameControllerState : int {
-    welcome, init, makemove, animate, contgame, finishedlevel, cleanup,
+    loading, welcome, init, makemove, animate, contgame, finishedlevel, cleanup,
     gameover, prompt, quit, not_applicable
 };
 
-void GameController::initDrawersAndSounds()
+static const char* STATE_NAMES[] = {
+    "loading", "welcome", "init", "makemove", "animate", "contgame", "finishedlevel", "cleanup",
+    "gameover", "prompt", "quit", "not_applicable"
+};
+
+void GameController::startLoadingAssets()
 {
     SpriteInfo drawers[] = {
 	{ IID_PLAYER               , 0, "socrates.tga" },
@@ -79,7 +94,7 @@ void GameController::initDrawersAndSounds()
 	{ IID_FOOD                 , 0, "pizza.tga" },
     };
 
-    SoundMapType::value_type sounds[] = {
+    pair<int, string> sounds[] = {
 	make_pair(SOUND_PLAYER_FIRE    , "flame.wav"),
 	make_pair(SOUND_SALMONELLA_HURT, "hurt.wav"),
 	make_pair(SOUND_ECOLI_HURT     , "hurt.wav"),
@@ -94,19 +109,90 @@ void GameController::initDrawersAndSounds()
 	make_pair(SOUND_BACTERIUM_BORN , "born.wav")
     };
 
-    string path = m_gw->assetPath();
+      // priority, most simultaneous instances, minimum ms between starts
+    pair<int, VoicePolicy> voicePolicies[] = {
+	make_pair(SOUND_PLAYER_DIE     , VoicePolicy{ 10, 1,   0 }),
+	make_pair(SOUND_FINISHED_LEVEL , VoicePolicy{  9, 1,   0 }),
+	make_pair(SOUND_THEME          , VoicePolicy{  8, 1,   0 }),
+	make_pair(SOUND_PLAYER_HURT    , VoicePolicy{  7, 1, 100 }),
+	make_pair(SOUND_GOT_GOODIE     , VoicePolicy{  6, 2,  50 }),
+	make_pair(SOUND_PLAYER_FIRE    , VoicePolicy{  6, 2,  50 }),
+	make_pair(SOUND_PLAYER_SPRAY   , VoicePolicy{  5, 3,  40 }),
+	make_pair(SOUND_ECOLI_DIE      , VoicePolicy{  4, 3,  60 }),
+	make_pair(SOUND_SALMONELLA_DIE , VoicePolicy{  4, 3,  60 }),
+	make_pair(SOUND_ECOLI_HURT     , VoicePolicy{  3, 3,  60 }),
+	make_pair(SOUND_SALMONELLA_HURT, VoicePolicy{  3, 3,  60 }),
+	make_pair(SOUND_BACTERIUM_BORN , VoicePolicy{  1, 2, 100 })
+    };
+
+    for (const auto& p : voicePolicies)
+        SoundFX().setPolicy(p.first, p.second);
     for (const SpriteInfo& d : drawers)
+        m_assetLoader.addSprite(d.imageID, d.frameNum, d.tgaFileName);
+    for (const auto& s : sounds)
+        m_assetLoader.addSound(s.first, s.second);
+    m_assetLoader.start(m_gw->assetPath(), m_assetBundle);
+}
+
+  // On the GL thread, each frame until everything is resident: take what
+  // the loader has finished, then upload sprites for no longer than the
+  // per-frame budget, so the window keeps drawing meanwhile.
+void GameController::pumpAssetLoading()
+{
+    if (!m_assetsHandedOver)
     {
-        if (!m_spriteManager.loadSprite(path + d.tgaFileName, d.imageID, d.frameNum))
+        if (!m_assetLoader.done())
+            return;
+        TRACE_SCOPE("assets", "hand over");
+        m_assetLoader.finish();
+        for (AssetLoader::Sprite& s : m_assetLoader.sprites())
+        {
+            bool loaded;
+            if (m_software != nullptr)
+                loaded = m_software->addSprite(s.pixels, s.imageID, s.frameNum);
+            else if (!s.decoded.empty())
+                loaded = m_spriteManager.addSprite(std::move(s.decoded), s.imageID, s.frameNum);
+            else
+                loaded = m_spriteManager.addSprite(s.pixels, s.imageID, s.frameNum);
+            if (!loaded)
+            {
+                cout << "Cannot load sprite " << m_gw->assetPath() + s.fileName << endl;
+                exit(1);
+            }
+        }
+          // every sound decoded up front so playing one never touches the disk
+        for (AssetLoader::Sound& s : m_assetLoader.sounds())
+        {
+            if (m_soundBank.add(s.soundID, std::move(s.clip)))
+                SoundFX().registerClip(s.soundID, *m_soundBank.clip(s.soundID));
+            else
+                cout << "Cannot load sound " << s.fileName << "; it will be silent." << endl;
+        }
+#ifdef SOUNDFX_SOFTWARE_MIXER
+        if (!m_options.audioSink.empty()  &&  !SoundFX().startMixer(m_options.audioSink))
+            cout << "Cannot start audio sink " << m_options.audioSink << "; game will be silent." << endl;
+#endif
+        startCapture();     // with the mixer, so a recorded video and its audio start together
+        if (m_software == nullptr  &&  !m_spriteManager.beginAtlas())
             exit(1);
+        m_assetsHandedOver = true;
     }
-    for (const auto& s : sounds)
-        m_soundMap[s.first] = s.second;
+    if (m_software == nullptr)
+    {
+        TRACE_SCOPE("assets", "upload sprites");
+        bool uploaded = m_spriteManager.uploadAtlas(m_options.uploadBudgetMs);
+        m_framesUploaded = static_cast<int>(m_assetLoader.sprites().size()) - m_spriteManager.framesPending();
+        if (!uploaded)
+            return;
+    }
+    else
+        m_framesUploaded = static_cast<int>(m_assetLoader.sprites().size());
+    m_assetsResident.store(true, memory_order_release);
 }
 
-static void doSomethingCallback()
+static void displayCallback()
 {
-    Game().doSomething();
+    Game().render();
 }
 
 static void reshapeCallback(int w, int h)
@@ -126,20 +212,133 @@ static void specialKeyboardEventCallback(int key, int x, int y)
 
 static void timerFuncCallback(int)
 {
-    Game().doSomething();
-    glutTimerFunc(MS_PER_FRAME, timerFuncCallback, 0);
+    Game().frameTimer();
+}
+
+void GameController::applyOptions(int& argc, char* argv[])
+{
+    m_options.parse(argc, argv);
+    m_timestep.configure(m_options.msPerTick, m_options.turbo, m_options.maxCatchUp);
+    m_frameScheduler.configure(m_options.frameMs);
+    m_input.configure(static_cast<InputQueue::Policy>(m_options.inputPolicy));
+    if (!m_options.traceFile.empty()  &&  !Tracer::instance().start(m_options.traceFile))
+        cout << "Cannot trace to " << m_options.traceFile << endl;
+    if (!m_options.actorLogFile.empty())
+    {
+#ifdef KONTAGION_PROFILE
+        if (!ActorAccounting::instance().openTickLog(m_options.actorLogFile))
+            cout << "Cannot write actor costs to " << m_options.actorLogFile << endl;
+#else
+        cout << "--actor-log needs a build with KONTAGION_PROFILE defined" << endl;
+#endif
+    }
+
+    unsigned seed = (m_options.seeded ? m_options.seed : random_device()());
+    if (!m_options.replayFile.empty())
+    {
+        if (!m_replay.startPlayback(m_options.replayFile, seed))
+            exit(1);
+    }
+    else if (!m_options.recordFile.empty())
+    {
+        if (!m_replay.startRecording(m_options.recordFile, seed))
+            exit(1);
+    }
+    else if (!m_options.seeded)
+        return;
+    seedRandom(seed);
 }
 
 void GameController::run(int argc, char* argv[], GameWorld* gw, string windowTitle)
 {
+    Tracer::nameThread("main");
+    applyOptions(argc, argv);
     gw->setController(this);
     m_gw = gw;
-    setGameState(welcome);
-    m_lastKeyHit = INVALID_KEY;
+    setGameState(loading);
     m_singleStep = false;
-    m_curIntraFrameTick = 0;
+    m_quitRequested = false;
+    m_finished = false;
     m_playerWon = false;
+    m_ticksSincePublish = 0;
+    m_windowWidth = WINDOW_WIDTH;
+    m_windowHeight = WINDOW_HEIGHT;
+    m_ticksRun = 0;
+    m_snapshotSequence = 0;
+    m_shownSequence = 0;
+    m_statTextVersion = 0;
+    m_hudList = 0;
+    m_hudListVersion = 0;
+    m_softwareSequence = 0;
+    m_framesDumped = 0;
+    m_assetsHandedOver = false;
+    m_assetsResident = false;
+    m_framesUploaded = 0;
+    m_loadingPercent = -1;
+    startLoadingAssets();   // decodes while the window opens
+#ifdef _MSC_VER
+    timeBeginPeriod(1);     // so the frame scheduler's sleeps end on time
+#endif
+
+    if (m_options.headless)
+    {
+          // no window and no keyboard: draw in memory, at the timer's pace,
+          // or sooner when a tick is due before the next frame
+        m_software.reset(new SoftwareRenderer);
+        if (m_options.threaded)
+            m_simulationThread = thread(&GameController::simulationLoop, this);
+        m_frameScheduler.reset();
+        while (!m_finished)
+        {
+            m_frameScheduler.beginFrame();
+            frame();
+            m_frameScheduler.endFrame();
+            if (!m_simulationThread.joinable())
+                m_frameScheduler.dueWithin(idleMs());
+            m_frameScheduler.waitUntilDue();
+        }
+    }
+    else
+        runWindowed(argc, argv, windowTitle);
+
+    quitGame();
+    if (m_simulationThread.joinable())
+        m_simulationThread.join();
+#ifdef _MSC_VER
+    timeEndPeriod(1);
+#endif
+    m_assetLoader.finish();
+    if (m_capture.isOpen())
+    {
+        m_capture.close();
+        m_capture.stats().print(cout);
+    }
+#ifdef SOUNDFX_SOFTWARE_MIXER
+    SoundFX().stopMixer(m_options.audioStats ? &cout : nullptr);
+#endif
+    m_replay.finish();
+    if (m_options.paceStats)
+    {
+        m_timestep.printStats(cout);
+        m_frameScheduler.printStats(cout);
+        m_input.stats().print(cout);
+    }
+    if (m_options.latencyStats)
+        printLatencyStats();
+    if (Tracer::enabled())
+    {
+        Tracer::instance().stop();
+        cout << "Trace: " << Tracer::instance().eventsWritten() << " events written to " << m_options.traceFile << endl;
+    }
+    if (m_options.eventStats  &&  m_gw->tickEvents() != nullptr)
+        m_gw->tickEvents()->telemetry().print(cout);
+    PROFILE_REPORT(cout);
+    ACCOUNT_REPORT(cout);
+    delete m_gw;
+}
 
+void GameController::runWindowed(int& argc, char* argv[], string windowTitle)
+{
     glutInit(&argc, argv);
 
     glutInitDisplayMode(GLUT_RGB | GLUT_DEPTH | GLUT_DOUBLE);
@@ -147,45 +346,72 @@ void GameController::run(int argc, char* argv[], GameWorld* gw, string windowTit
     glutInitWindowPosition(0, 0);
     glutCreateWindow(windowTitle.c_str());
 
-    initDrawersAndSounds();
-
     glutKeyboardFunc(keyboardEventCallback);
     glutSpecialFunc(specialKeyboardEventCallback);
     glutReshapeFunc(reshapeCallback);
-    glutDisplayFunc(doSomethingCallback);
-    glutTimerFunc(MS_PER_FRAME, timerFuncCallback, 0);
+    glutDisplayFunc(displayCallback);
+    m_frameScheduler.reset();
+    glutTimerFunc(0, timerFuncCallback, 0);
+
+    if (m_options.threaded)
+        m_simulationThread = thread(&GameController::simulationLoop, this);
 
     glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
     glutMainLoop();
-    delete m_gw;
 }
 
 void GameController::keyboardEvent(unsigned char key, int /* x */, int /* y */)
 {
     switch (key)
     {
-        case 'a': case '4': m_lastKeyHit = KEY_PRESS_LEFT;  break;
-        case 'd': case '6': m_lastKeyHit = KEY_PRESS_RIGHT; break;
-        case 'w': case '8': m_lastKeyHit = KEY_PRESS_UP;    break;
-        case 's': case '2': m_lastKeyHit = KEY_PRESS_DOWN;  break;
-        case 't':           m_lastKeyHit = KEY_PRESS_TAB;   break;
-        case 'f':           m_singleStep = true;            break;
-        case 'r':           m_singleStep = false;           break;
-        case 'q': case 'Q': quitGame();                     break;
-        default:            m_lastKeyHit = key;             break;
+        case 'a': case '4': m_input.push(KEY_PRESS_LEFT);  break;
+        case 'd': case '6': m_input.push(KEY_PRESS_RIGHT); break;
+        case 'w': case '8': m_input.push(KEY_PRESS_UP);    break;
+        case 's': case '2': m_input.push(KEY_PRESS_DOWN);  break;
+        case 't':           m_input.push(KEY_PRESS_TAB);   break;
+        case 'f':           m_singleStep = true;           break;
+        case 'r':           m_singleStep = false;          break;
+        case 'q': case 'Q': quitGame();                    break;
+        default:            m_input.push(key);             break;
     }
+    keyArrived();
 }
 
 void GameController::specialKeyboardEvent(int key, int /* x */, int /* y */)
 {
     switch (key)
     {
-        case GLUT_KEY_LEFT:  m_lastKeyHit = KEY_PRESS_LEFT;  break;
-        case GLUT_KEY_RIGHT: m_lastKeyHit = KEY_PRESS_RIGHT; break;
-        case GLUT_KEY_UP:    m_lastKeyHit = KEY_PRESS_UP;    break;
-        case GLUT_KEY_DOWN:  m_lastKeyHit = KEY_PRESS_DOWN;  break;
-        default:             m_lastKeyHit = INVALID_KEY;     break;
+        case GLUT_KEY_LEFT:  m_input.push(KEY_PRESS_LEFT);  break;
+        case GLUT_KEY_RIGHT: m_input.push(KEY_PRESS_RIGHT); break;
+        case GLUT_KEY_UP:    m_input.push(KEY_PRESS_UP);    break;
+        case GLUT_KEY_DOWN:  m_input.push(KEY_PRESS_DOWN);  break;
+        case GLUT_KEY_F12:   Tracer::instance().flush();    return;
+        default:                                            return;
     }
+    keyArrived();
+}
+
+  // Restart whatever stopped to wait for a key: the frame timer, or the
+  // simulation thread.
+void GameController::keyArrived()
+{
+    m_keySignal.raise();
+    if (m_frameScheduler.wake())
+        glutTimerFunc(0, timerFuncCallback, 0);
+}
+
+bool GameController::getWorldKey(int& value)
+{
+    if (m_replay.isPlaying())
+        return m_replay.keyForTick(value);
+    InputEvent event;
+    if (!m_input.next(event))
+        return false;
+    value = event.key;
+    m_replay.noteKey(value);
+      // the next snapshot published is the first that can show the result
+    m_inputsInFlight.push(InputInFlight{ m_snapshotSequence + 1, event.time, InputEvent::Clock::now() });
+    return true;
 }
 
 void GameController::playSound(int soundID)
@@ -196,9 +422,7 @@ void GameController::playSound(int soundID)
         return;
     }
 
-    SoundMapType::const_iterator p = m_soundMap.find(soundID);
-    if (p != m_soundMap.end())
-        SoundFX().playClip(m_gw->assetPath() + p->second);
+    SoundFX().playClip(soundID);
 }
 
 void GameController::setGameState(GameControllerState s)
@@ -214,19 +438,119 @@ void GameController::setGameStateAfterPrompting(GameControllerState s,
     m_secondMessage = secondMessage;
     m_nextStateAfterPrompt = s;
     setGameState(prompt);
+    publishPrompt();
 }
 
 void GameController::quitGame()
 {
-    setGameState(quit);
+    m_quitRequested = true;
+    m_keySignal.raise();
+}
+
+void GameController::frame()
+{
+    if (!m_simulationThread.joinable())
+        doSomething();
+    if (screenIsCurrent())
+        m_frameScheduler.noteUnchanged();
+    else
+        render();
+}
+
+void GameController::frameTimer()
+{
+    m_frameScheduler.waitUntilDue();    // the timer only counts whole ms
+    m_frameScheduler.beginFrame();
+    frame();
+    m_frameScheduler.endFrame();
+      // With the state machine on this thread, nothing happens until a key
+      // arrives, so stop until one does.  A simulation thread cannot restart
+      // the timer when it publishes, so then the timer keeps running, but
+      // frames with nothing new cost next to nothing.
+    if (!m_simulationThread.joinable()  &&  waitingForKey()  &&  screenIsCurrent())
+        m_frameScheduler.idle();
+    else
+        glutTimerFunc(m_frameScheduler.wholeMsUntilDue(), timerFuncCallback, 0);
+}
+
+void GameController::simulationLoop()
+{
+    Tracer::nameThread("simulation");
+    while (!m_finished)
+    {
+        doSomething();
+        if (waitingForKey())
+            m_keySignal.wait();
+        else
+            FrameScheduler::sleepFor(idleMs());
+    }
+}
+
+  // How long to sleep before the next pass: until the next tick is due,
+  // but no longer than a frame.
+double GameController::idleMs() const
+{
+    double waitMs = m_options.frameMs;
+    if (m_gameState == makemove  &&  !m_singleStep)
+        waitMs = min(waitMs, m_timestep.msUntilNextTick());
+    return waitMs;
+}
+
+  // Whether the state machine can do nothing more until a key arrives: at a
+  // prompt someone has to dismiss, or paused between single steps.
+bool GameController::waitingForKey() const
+{
+    if (m_quitRequested  ||  m_input.hasPending())
+        return false;
+    if (m_gameState == prompt)
+        return !m_replay.isPlaying()  &&  !m_options.headless;
+    return m_gameState == makemove  &&  m_singleStep;
+}
+
+  // Whether drawing again would show what is already on screen: nothing
+  // newer has been published, and what has been is a prompt or a paused
+  // single step, which don't move.  While capturing, every frame is drawn
+  // so the video keeps time.
+bool GameController::screenIsCurrent()
+{
+    if (m_finished  ||  m_capture.isOpen()  ||  !m_assetsResident.load(memory_order_relaxed)
+        ||  m_snapshots.hasFresh())
+        return false;
+    const DrawSnapshot& snapshot = m_snapshots.latest();
+    if (snapshot.sequence != m_shownSequence)
+        return false;
+    return snapshot.kind == DrawSnapshot::prompt
+        ||  (snapshot.kind == DrawSnapshot::gameplay  &&  snapshot.ticksPerMs == 0  &&  m_singleStep);
 }
 
 void GameController::doSomething()
 {
+    if (m_quitRequested)
+        setGameState(quit);
+
+    TRACE_SCOPE("controller", STATE_NAMES[m_gameState]);
     switch (m_gameState)
     {
         case not_applicable:
             break;
+        case loading:
+            if (m_assetsResident.load(memory_order_acquire))
+                setGameState(welcome);
+            else if (!m_options.headless)
+            {
+                  // the welcome screen, counting up until the game can start
+                int total = m_assetLoader.total() + static_cast<int>(m_assetLoader.sprites().size());
+                int done = m_assetLoader.completed() + m_framesUploaded.load();
+                int percent = (total > 0 ? 100 * done / total : 100);
+                if (percent != m_loadingPercent)
+                {
+                    m_loadingPercent = percent;
+                    m_mainMessage = "Welcome to Kontagion!";
+                    m_secondMessage = "Loading... " + to_string(percent) + "%";
+                    publishPrompt();
+                }
+            }
+            break;
         case welcome:
             playSound(SOUND_THEME);
             setGameStateAfterPrompting(init, "Welcome to Kontagion!", "Press Enter to begin play...");
@@ -247,41 +571,43 @@ void GameController::doSomething()
                         "Press Enter to quit...");
                 }
                 else
+                {
+                    m_timestep.reset();
                     setGameState(makemove);
+                    publishGameplay();
+                }
             }
             break;
         case makemove:
-            m_curIntraFrameTick = ANIMATION_POSITIONS_PER_TICK;
+              // run however many ticks are due, then draw the result
             m_nextStateAfterAnimate = not_applicable;
+            if (m_singleStep)
             {
-                int status = m_gw->move();
-                if (status == GWSTATUS_PLAYER_DIED)
-                {
-                      // animate one last frame so the player can see what happened
-                    m_nextStateAfterAnimate = (m_gw->isGameOver() ? gameover : contgame);
-                }
-                else if (status == GWSTATUS_FINISHED_LEVEL)
-                {
-                    m_gw->advanceToNextLevel();
-                      // animate one last frame so the player can see what happened
-                    m_nextStateAfterAnimate = finishedlevel;
-                }
+                int key;
+                if (getLastKey(key))
+                    runTick();
+                m_timestep.reset();  // don't bank time while paused
             }
-            setGameState(animate);
-            break;
-        case animate:
-            displayGamePlay();
-            if (m_curIntraFrameTick-- <= 0)
+            else
             {
-                if (m_nextStateAfterAnimate != not_applicable)
-                    setGameState(m_nextStateAfterAnimate);
-                else
+                m_timestep.beginFrame();
+                while (m_nextStateAfterAnimate == not_applicable  &&  m_timestep.shouldTick())
                 {
-                    int key;
-                    if (!m_singleStep  ||  getLastKey(key))
-                        setGameState(makemove);
+                    runTick();
+                    m_timestep.tickDone();
                 }
+                m_timestep.endFrame();
             }
+            setGameState(animate);
+            // fall through
+        case animate:
+              // hand what the ticks produced to the renderer
+            if (m_ticksSincePublish > 0)
+                publishGameplay();
+            if (m_nextStateAfterAnimate != not_applicable)
+                setGameState(m_nextStateAfterAnimate);
+            else
+                setGameState(makemove);
             break;
         case contgame:
             setGameStateAfterPrompting(cleanup, "You lost a life!",
@@ -294,6 +620,7 @@ void GameController::doSomething()
         case cleanup:
             m_gw->cleanUp();
             setGameState(init);
+            Tracer::instance().flush();     // between levels, so not mid-play
             break;
         case gameover:
             {
@@ -305,21 +632,244 @@ void GameController::doSomething()
             }
             break;
         case prompt:
-            drawPrompt(m_mainMessage, m_secondMessage);
             {
+                  // replays and headless runs are unattended, so their
+                  // prompts dismiss themselves
+                bool dismissed = (m_replay.isPlaying()  ||  m_options.headless);
                 int key;
-                if (getLastKey(key) && key == '\r')
+                while (!dismissed  &&  getLastKey(key))
+                    dismissed = (key == '\r');
+                if (dismissed)
                     setGameState(m_nextStateAfterPrompt);
             }
             break;
         case quit:
             SoundFX().abortClip();
+            m_finished = true;
+            break;
+    }
+}
+
+void GameController::runTick()
+{
+    if (!m_replay.beginTick())
+    {
+        m_nextStateAfterAnimate = quit;
+        return;
+    }
+    GraphObject::beginTick();
+    m_input.beginTick();
+    int status = m_gw->move();
+    m_replay.endTick(*m_gw);
+    m_ticksSincePublish++;
+    m_ticksRun++;
+    if (status == GWSTATUS_PLAYER_DIED)
+    {
+          // animate one last frame so the player can see what happened
+        m_nextStateAfterAnimate = (m_gw->isGameOver() ? gameover : contgame);
+    }
+    else if (status == GWSTATUS_FINISHED_LEVEL)
+    {
+        m_gw->advanceToNextLevel();
+          // animate one last frame so the player can see what happened
+        m_nextStateAfterAnimate = finishedlevel;
+    }
+}
+
+void GameController::publishGameplay()
+{
+    TRACE_SCOPE("controller", "publish");
+    DrawSnapshot& snapshot = m_snapshots.back();
+    snapshot.kind = DrawSnapshot::gameplay;
+    snapshot.sequence = ++m_snapshotSequence;
+    snapshot.ticks = m_ticksRun;
+    GraphObject::captureAllObjects(snapshot.items, snapshot.staticItems);
+    snapshot.staticVersion = GraphObject::staticLayerVersion();
+    if (snapshot.statVersion != m_statTextVersion)
+    {
+        snapshot.statText = m_gameStatText;
+        snapshot.statVersion = m_statTextVersion;
+    }
+    snapshot.published = DrawSnapshot::Clock::now();
+      // Blend positions by how far the clock has run past the last tick,
+      // unless nothing advances the clock (single-stepping) or told not to.
+    if (m_singleStep  ||  m_options.motion == GameOptions::snap)
+    {
+        snapshot.alpha = 1;
+        snapshot.ticksPerMs = 0;
+        snapshot.extrapolate = false;
+    }
+    else
+    {
+        snapshot.alpha = m_timestep.alpha();
+        snapshot.ticksPerMs = m_timestep.ticksPerMs();
+        snapshot.extrapolate = (m_options.motion == GameOptions::extrapolate);
+    }
+    m_snapshots.publish();
+    m_ticksSincePublish = 0;
+}
+
+void GameController::publishPrompt()
+{
+    DrawSnapshot& snapshot = m_snapshots.back();
+    snapshot.kind = DrawSnapshot::prompt;
+    snapshot.sequence = ++m_snapshotSequence;
+    snapshot.ticks = m_ticksRun;
+    snapshot.items.clear();
+    snapshot.mainMessage = m_mainMessage;
+    snapshot.secondMessage = m_secondMessage;
+    m_snapshots.publish();
+}
+
+void GameController::render()
+{
+    if (m_finished)
+    {
+        if (m_software == nullptr)
             glutLeaveMainLoop();
+        return;
+    }
+
+    if (!m_assetsResident.load(memory_order_relaxed))
+        pumpAssetLoading();
+
+    const DrawSnapshot& snapshot = m_snapshots.latest();
+    if (m_software != nullptr)
+    {
+        renderSoftware(snapshot);
+        return;
+    }
+    TRACE_SCOPE("frame", "render");
+    switch (snapshot.kind)
+    {
+        case DrawSnapshot::gameplay:
+            displayGamePlay(snapshot);
+            break;
+        case DrawSnapshot::prompt:
+            drawPrompt(snapshot.mainMessage, snapshot.secondMessage);
             break;
+        case DrawSnapshot::none:
+            return;
+    }
+    captureFrame(snapshot);
+    {
+        TRACE_SCOPE("frame", "swap");
+        glutSwapBuffers();
     }
+    noteFrameShown(snapshot.sequence);
 }
 
-void GameController::displayGamePlay()
+  // Every key acted on in a tick this frame includes has now reached the
+  // screen, as far as we can tell without a display timestamp.
+void GameController::noteFrameShown(uint64_t sequence)
+{
+    m_shownSequence = sequence;
+    InputEvent::Clock::time_point now = InputEvent::Clock::now();
+    InputInFlight input;
+    while (m_inputsInFlight.peek(input)  &&  input.sequence <= sequence)
+    {
+        m_inputsInFlight.pop(input);
+        using Ms = chrono::duration<double, milli>;
+        m_inputToTick.record(Ms(input.consumed - input.arrived).count());
+        m_tickToSwap.record(Ms(now - input.consumed).count());
+        m_inputToSwap.record(Ms(now - input.arrived).count());
+    }
+}
+
+void GameController::printLatencyStats() const
+{
+    cout << "Input latency:" << endl;
+    m_inputToTick.print(cout, "key to tick");
+    m_tickToSwap.print(cout, "tick to swap");
+    m_inputToSwap.print(cout, "key to swap");
+}
+
+void GameController::startCapture()
+{
+    if (m_options.captureFile.empty())
+        return;
+      // a frame per frame deadline in a window, a frame per tick when
+      // headless; frames are placed in the stream by when they were shown
+    int width = WINDOW_WIDTH, height = WINDOW_HEIGHT;
+    long long fpsNum = 1000000, fpsDen = max(1LL, llround(1000 * m_options.frameMs));
+    if (m_options.headless)
+    {
+        width = SoftwareRenderer::WIDTH;
+        height = SoftwareRenderer::HEIGHT;
+        fpsDen = max(1LL, llround(1000 * m_options.msPerTick));
+    }
+    long long divisor = gcd(fpsNum, fpsDen);
+    if (!m_capture.open(m_options.captureFile, width, height,
+                        static_cast<int>(fpsNum / divisor), static_cast<int>(fpsDen / divisor)))
+        cout << "Cannot capture to " << m_options.captureFile << endl;
+    else if (m_software == nullptr  &&  (m_windowWidth != width  ||  m_windowHeight != height))
+        glutReshapeWindow(width, height);
+}
+
+  // Copy what was just drawn into a capture buffer; when none is free, or
+  // the window isn't the capture's size, the frame is dropped, never waited
+  // for.  Headless frames are stamped with
+  // the simulated time of their snapshot, one tick per video frame; window
+  // frames with the time they were drawn.
+void GameController::captureFrame(const DrawSnapshot& snapshot)
+{
+    if (!m_capture.isOpen())
+        return;
+    if (m_software == nullptr  &&  (m_windowWidth != m_capture.width()  ||  m_windowHeight != m_capture.height()))
+    {
+        m_capture.drop();
+        return;
+    }
+    uint8_t* buffer = m_capture.acquire();
+    if (buffer == nullptr)
+        return;
+    if (m_software != nullptr)
+    {
+        memcpy(buffer, m_software->pixels(), static_cast<size_t>(m_capture.width()) * m_capture.height() * 4);
+        m_capture.submit(false, snapshot.ticks * m_options.msPerTick);
+    }
+    else
+    {
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadBuffer(GL_BACK);
+        glReadPixels(0, 0, m_capture.width(), m_capture.height(), GL_RGBA, GL_UNSIGNED_BYTE, buffer);
+        m_capture.submit(true, m_capture.msSinceOpen());
+    }
+}
+
+template<typename Renderer>
+void GameController::plotItem(Renderer& renderer, const DrawItem& item, double alpha, bool extrapolate)
+{
+    int numFrames = renderer.getNumFrames(item.imageID);
+    if (numFrames == 0)
+        return;
+    double x, y;
+    item.position(alpha, extrapolate, x, y);
+    int frame = item.animationNumber % numFrames;
+    renderer.plotSprite(item.imageID, frame, x, y, item.direction, item.size, item.depth);
+}
+
+  // Everything but the HUD, onto a cleared frame.  The dirt, pits and dish
+  // rim come from the renderer's cached copy unless one of them has changed
+  // since it was taken.
+template<typename Renderer>
+void GameController::drawActors(Renderer& renderer, const DrawSnapshot& snapshot, double alpha)
+{
+    if (!renderer.drawStaticLayer(snapshot.staticVersion))
+    {
+        for (const DrawItem& item : snapshot.staticItems)
+            plotItem(renderer, item, 1, false);
+        renderer.flushSprites();
+        renderer.drawCircle(VIEW_WIDTH / 2, VIEW_HEIGHT / 2, VIEW_WIDTH / 2 + SPRITE_WIDTH, 100);
+        renderer.captureStaticLayer(snapshot.staticVersion);
+    }
+
+    for (const DrawItem& item : snapshot.items)
+        plotItem(renderer, item, alpha, snapshot.extrapolate);
+    renderer.flushSprites();
+}
+
+void GameController::displayGamePlay(const DrawSnapshot& snapshot)
 {
     glEnable(GL_DEPTH_TEST); // must be done each time before displaying graphics or gets disabled for some reason
     glLoadIdentity();
@@ -333,22 +883,46 @@ void GameController::displayGamePlay()
 #pragma GCC diagnostic pop
 #endif
 
-    GraphObject::drawAllObjects(
-        [=](int imageID, int animationNumber, double x, double y, int angle, double size)
-        {
-            int frame = animationNumber % m_spriteManager.getNumFrames(imageID);
-            m_spriteManager.plotSprite(imageID, frame, x, y, angle, size);
-        });
+    glColor3f(.6f, .6f, .6f);       // for the dish rim
+    drawActors(m_spriteManager, snapshot, snapshot.alphaAt(DrawSnapshot::Clock::now()));
+
+    drawScoreAndLives(snapshot);
+}
 
-    drawScoreAndLives(m_gameStatText);
+  // Headless frames show each snapshot once, as of the end of its tick, so
+  // the same run always produces the same frames.
+void GameController::renderSoftware(const DrawSnapshot& snapshot)
+{
+    if (snapshot.sequence == m_softwareSequence)
+        return;
+    m_softwareSequence = snapshot.sequence;
+    TRACE_SCOPE("frame", "render (software)");
 
-    SpriteManager::drawCircle(VIEW_WIDTH / 2, VIEW_HEIGHT / 2, VIEW_WIDTH / 2 + SPRITE_WIDTH, 100);
+    m_software->clear();
+    if (snapshot.kind == DrawSnapshot::gameplay)
+        drawActors(*m_software, snapshot, 1);
+    captureFrame(snapshot);
+    noteFrameShown(snapshot.sequence);
 
-    glutSwapBuffers();
+    if (!m_options.frameDumpDir.empty())
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/frame%06u.tga", m_framesDumped++);
+        if (!m_software->writeTga(m_options.frameDumpDir + name))
+        {
+            cout << "Cannot write frames to " << m_options.frameDumpDir << endl;
+            m_options.frameDumpDir.clear();
+        }
+    }
 }
 
 void GameController::reshape (int w, int h)
 {
+    m_windowWidth = w;
+    m_windowHeight = h;
+      // the capture is a fixed size, so hold the window to it while recording
+    if (m_capture.isOpen()  &&  (w != m_capture.width()  ||  h != m_capture.height()))
+        glutReshapeWindow(m_capture.width(), m_capture.height());
     glViewport (0, 0, (GLsizei) w, (GLsizei) h);
     glMatrixMode (GL_PROJECTION);
     glLoadIdentity ();
@@ -399,17 +973,19 @@ static void drawPrompt(string mainMessage, string secondMessage)
     glLoadIdentity ();
     outputStrokeCentered(1, -5, mainMessage.c_str());
     outputStrokeCentered(-1, -5, secondMessage.c_str());
-    glutSwapBuffers();
 }
 
-static void drawScoreAndLives(string gameStatText)
+void GameController::drawScoreAndLives(const DrawSnapshot& snapshot)
 {
+      // The flicker has its own generator so that the number of frames
+      // drawn cannot perturb the simulation's random sequence.
+    static default_random_engine flicker;
     static int RATE = 1;
     static GLfloat rgb[3] =
         { static_cast<GLfloat>(.6), static_cast<GLfloat>(.6), static_cast<GLfloat>(.6) };
     for (int k = 0; k < 3; k++)
     {
-        double strength = rgb[k] + randInt(-RATE, RATE) / 100.0;
+        double strength = rgb[k] + uniform_int_distribution<>(-RATE, RATE)(flicker) / 100.0;
         if (strength < .6)
             strength = .6;
         else if (strength > 1.0)
@@ -417,5 +993,17 @@ static void drawScoreAndLives(string gameStatText)
         rgb[k] = static_cast<GLfloat>(strength);
     }
     glColor3f(rgb[0], rgb[1], rgb[2]);
-    outputStrokeCentered(SCORE_Y, SCORE_Z, gameStatText.c_str());
+
+      // The strokes are replayed from a display list, recompiled only when
+      // the text changes; the colour is set outside it.
+    if (m_hudList == 0)
+        m_hudList = glGenLists(1);
+    if (snapshot.statVersion != m_hudListVersion)
+    {
+        glNewList(m_hudList, GL_COMPILE);
+        outputStrokeCentered(SCORE_Y, SCORE_Z, snapshot.statText.c_str());
+        glEndList();
+        m_hudListVersion = snapshot.statVersion;
+    }
+    glCallList(m_hudList);
 }
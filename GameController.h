@@ -2,10 +2,27 @@
 #define GAMECONTROLLER_H_
 
 #include "SpriteManager.h"
+#include "SoftwareRenderer.h"
+#include "FrameCapture.h"
+#include "SoundBank.h"
+#include "AssetBundle.h"
+#include "AssetLoader.h"
+#include "Replay.h"
+#include "FixedTimestep.h"
+#include "FrameScheduler.h"
+#include "GameOptions.h"
+#include "DrawSnapshot.h"
+#include "InputQueue.h"
+#include "LatencyHistogram.h"
+#include "SpscRing.h"
+#include "TripleBuffer.h"
 #include <string>
 #include <map>
 #include <iostream>
 #include <sstream>
+#include <atomic>
+#include <thread>
+#include <memory>
 
 const int INVALID_KEY = 0;
 
@@ -17,32 +34,64 @@ class GameController
   public:
     void run(int argc, char* argv[], GameWorld* gw, std::string windowTitle);
 
+      // Serve sprites and sounds from this bundle rather than from files in
+      // the asset directory; it must stay open while the game runs.
+    void setAssetBundle(const AssetBundle* bundle)
+    {
+        m_assetBundle = bundle;
+    }
+
+      // The oldest key not yet taken, for prompts and single-stepping.
     bool getLastKey(int& value)
     {
-        if (m_lastKeyHit != INVALID_KEY)
-        {
-            value = m_lastKeyHit;
-            m_lastKeyHit = INVALID_KEY;
-            return true;
-        }
-        return false;
+        InputEvent event;
+        if (!m_input.pop(event))
+            return false;
+        value = event.key;
+        return true;
     }
 
+      // The key consumed by the world this tick; comes from the replay
+      // when one is being played back.
+    bool getWorldKey(int& value);
+
     void playSound(int soundID);
 
-    void setGameStatText(std::string text)
+    void setGameStatText(const std::string& text)
     {
-        m_gameStatText = text;
+        if (text != m_gameStatText)
+        {
+            m_gameStatText = text;
+            m_statTextVersion++;
+        }
     }
 
+      // Advance the game state machine; never touches OpenGL.
     void doSomething();
 
+      // Draw the latest published snapshot; must run on the GLUT thread,
+      // unless headless.
+    void render();
+
+      // One timer pass: step the state machine here unless it has a thread
+      // of its own, then render if the screen is out of date.
+    void frame();
+
+      // The GLUT timer: one frame on the schedule, then re-arm for the next
+      // unless there is nothing to do until a key arrives.
+    void frameTimer();
+
     void reshape(int w, int h);
     void keyboardEvent(unsigned char key, int x, int y);
     void specialKeyboardEvent(int key, int x, int y);
 
     void quitGame();
 
+    const PacingStats& pacingStats() const
+    {
+        return m_timestep.stats();
+    }
+
       // Meyers singleton pattern
     static GameController& getInstance()
     {
@@ -57,24 +106,84 @@ private:
     GameControllerState m_gameState;
     GameControllerState m_nextStateAfterPrompt;
     GameControllerState m_nextStateAfterAnimate;
-    int         m_lastKeyHit;
-    bool        m_singleStep;
+    InputQueue        m_input;
+
+      // a key the world has acted on, until a frame showing the result is swapped
+    struct InputInFlight
+    {
+        uint64_t                      sequence;   // first snapshot to include the tick
+        InputEvent::Clock::time_point arrived;
+        InputEvent::Clock::time_point consumed;
+    };
+    SpscRing<InputInFlight, 64> m_inputsInFlight;  // simulation -> render
+    LatencyHistogram  m_inputToTick;               // render thread only
+    LatencyHistogram  m_tickToSwap;
+    LatencyHistogram  m_inputToSwap;
+    std::atomic<bool> m_singleStep;
+    std::atomic<bool> m_quitRequested;
+    std::atomic<bool> m_finished;
     std::string m_gameStatText;
+    uint64_t    m_statTextVersion;
+    GLuint      m_hudList;          // the status line's strokes, compiled
+    uint64_t    m_hudListVersion;
     std::string m_mainMessage;
     std::string m_secondMessage;
-    int         m_curIntraFrameTick;
-    using SoundMapType = std::map<int, std::string>;
     using DrawMapType =  std::map<int, std::string>;
-    SoundMapType  m_soundMap;
+    SoundBank     m_soundBank;
+    const AssetBundle* m_assetBundle = nullptr;
+    AssetLoader   m_assetLoader;
+    bool          m_assetsHandedOver;   // by the loader; GL thread only
+    std::atomic<bool> m_assetsResident; // everything uploaded and registered
+    std::atomic<int>  m_framesUploaded;
+    int           m_loadingPercent;     // last shown
     bool          m_playerWon;
     SpriteManager m_spriteManager;
+    Replay        m_replay;
+    GameOptions   m_options;
+    FixedTimestep m_timestep;
+    FrameScheduler m_frameScheduler;    // the thread calling frame() only
+    WakeSignal    m_keySignal;          // for a simulation thread waiting on a key
+    uint64_t      m_shownSequence;      // of the snapshot on screen
+    int           m_ticksSincePublish;
+    int           m_windowWidth;        // as last reshaped
+    int           m_windowHeight;
+    uint64_t      m_ticksRun;
+    uint64_t      m_snapshotSequence;
+    TripleBuffer<DrawSnapshot> m_snapshots;
+    std::thread   m_simulationThread;
+    std::unique_ptr<SoftwareRenderer> m_software;   // headless only
+    uint64_t      m_softwareSequence;
+    unsigned      m_framesDumped;
+    FrameCapture  m_capture;
 
     void setGameState(GameControllerState s);
     void setGameStateAfterPrompting(GameControllerState s,
                             std::string mainMessage, std::string secondMessage);
 
-    void initDrawersAndSounds();
-    void displayGamePlay();
+    void startLoadingAssets();
+    void pumpAssetLoading();
+    void applyOptions(int& argc, char* argv[]);
+    void runWindowed(int& argc, char* argv[], std::string windowTitle);
+    void runTick();
+    void simulationLoop();
+    void publishGameplay();
+    void publishPrompt();
+    void displayGamePlay(const DrawSnapshot& snapshot);
+    void drawScoreAndLives(const DrawSnapshot& snapshot);
+    void renderSoftware(const DrawSnapshot& snapshot);
+    double idleMs() const;
+    bool waitingForKey() const;
+    bool screenIsCurrent();
+    void keyArrived();
+    void startCapture();
+    void captureFrame(const DrawSnapshot& snapshot);
+    void noteFrameShown(uint64_t sequence);
+    void printLatencyStats() const;
+
+    template<typename Renderer>
+    void drawActors(Renderer& renderer, const DrawSnapshot& snapshot, double alpha);
+    template<typename Renderer>
+    void plotItem(Renderer& renderer, const DrawItem& item, double alpha, bool extrapolate);
 };
 
 inline GameController& Game()
@@ -0,0 +1,128 @@
+#ifndef GAMEOPTIONS_H_
+#define GAMEOPTIONS_H_
+
+#include "InputQueue.h"
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+  // Command line switches understood by the framework.  Recognized switches
+  // are removed from argv so that only the rest is handed to glutInit.
+
+struct GameOptions
+{
+      // how sprites are drawn between simulation ticks
+    enum Motion { snap, interpolate, extrapolate };
+
+    std::string recordFile;           // --record=FILE   write a replay of this session
+    std::string replayFile;           // --replay=FILE   play back and verify a replay
+    bool        seeded = false;       // --seed=N        fixed seed for randInt
+    unsigned    seed = 0;
+    double      msPerTick = 15;       // --tick-ms=N     simulation tick interval
+    double      turbo = 1;            // --turbo=N|max   simulated time per real time
+    int         maxCatchUp = 5;       // --max-catchup=N ticks per frame before dropping backlog
+    bool        paceStats = false;    // --pace-stats    print frame and tick pacing at exit
+    int         motion = interpolate; // --motion=snap|interpolate|extrapolate
+    bool        eventStats = false;   // --event-stats   print tick event telemetry at exit
+    std::string audioSink;            // --audio-sink=null|wav:FILE  software mixer output;
+                                      // --capture-audio=FILE is wav:FILE
+    bool        audioStats = false;   // --audio-stats   print mixer cost at exit
+    bool        threaded = false;     // --threaded      simulate on a thread of its own
+    bool        headless = false;     // --headless      no window; draw with the software renderer
+    std::string frameDumpDir;         // --frame-dump=DIR  headless: write each frame to DIR as TGA
+    std::string captureFile;          // --capture=FILE  record displayed frames as a Y4M video
+    int         inputPolicy = 0;      // --input=queue|latest  an InputQueue::Policy
+    bool        latencyStats = false; // --latency-stats  print key-to-screen latency at exit
+    double      uploadBudgetMs = 4;   // --upload-budget-ms=N  sprite upload time per frame while loading
+    double      frameMs = 5;          // --frame-ms=N  frame deadline: how often the screen is redrawn
+    std::string traceFile;            // --trace=FILE  trace_event JSON for chrome://tracing or Perfetto; F12 flushes
+    std::string actorLogFile;         // --actor-log=FILE  per-tick costs of each actor type as CSV (profiling builds)
+
+    void parse(int& argc, char* argv[])
+    {
+        int kept = 1;
+        for (int k = 1; k < argc; k++)
+        {
+            const char* arg = argv[k];
+            const char* value;
+            if ((value = match(arg, "--record=")) != nullptr)
+                recordFile = value;
+            else if ((value = match(arg, "--replay=")) != nullptr)
+                replayFile = value;
+            else if ((value = match(arg, "--seed=")) != nullptr)
+            {
+                seeded = true;
+                seed = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+            }
+            else if ((value = match(arg, "--tick-ms=")) != nullptr)
+                msPerTick = std::atof(value);
+            else if ((value = match(arg, "--turbo=")) != nullptr)
+            {
+                  // 0 is how FixedTimestep spells uncapped; only max asks for it
+                char* end;
+                double n = std::strtod(value, &end);
+                if (std::strcmp(value, "max") == 0)
+                    turbo = 0;
+                else if (end != value  &&  *end == '\0'  &&  n > 0)
+                    turbo = n;
+                else
+                    std::cerr << "Ignoring " << arg << ": expected a positive number or max" << std::endl;
+            }
+            else if ((value = match(arg, "--max-catchup=")) != nullptr)
+                maxCatchUp = std::atoi(value);
+            else if (std::strcmp(arg, "--pace-stats") == 0)
+                paceStats = true;
+            else if (std::strcmp(arg, "--event-stats") == 0)
+                eventStats = true;
+            else if ((value = match(arg, "--audio-sink=")) != nullptr)
+                audioSink = value;
+            else if (std::strcmp(arg, "--audio-stats") == 0)
+                audioStats = true;
+            else if (std::strcmp(arg, "--threaded") == 0)
+                threaded = true;
+            else if (std::strcmp(arg, "--headless") == 0)
+                headless = true;
+            else if ((value = match(arg, "--frame-dump=")) != nullptr)
+                frameDumpDir = value;
+            else if ((value = match(arg, "--capture=")) != nullptr)
+                captureFile = value;
+            else if ((value = match(arg, "--input=")) != nullptr)
+                inputPolicy = (std::strcmp(value, "latest") == 0 ? InputQueue::latest : InputQueue::queue);
+            else if (std::strcmp(arg, "--latency-stats") == 0)
+                latencyStats = true;
+            else if ((value = match(arg, "--upload-budget-ms=")) != nullptr)
+                uploadBudgetMs = std::atof(value);
+            else if ((value = match(arg, "--frame-ms=")) != nullptr)
+                frameMs = std::atof(value);
+            else if ((value = match(arg, "--trace=")) != nullptr)
+                traceFile = value;
+            else if ((value = match(arg, "--actor-log=")) != nullptr)
+                actorLogFile = value;
+            else if ((value = match(arg, "--capture-audio=")) != nullptr)
+                audioSink = std::string("wav:") + value;    // the mixer's output, alongside
+            else if ((value = match(arg, "--motion=")) != nullptr)
+            {
+                if (std::strcmp(value, "snap") == 0)
+                    motion = snap;
+                else if (std::strcmp(value, "extrapolate") == 0)
+                    motion = extrapolate;
+                else
+                    motion = interpolate;
+            }
+            else
+                argv[kept++] = argv[k];
+        }
+        argc = kept;
+        argv[argc] = nullptr;
+    }
+
+  private:
+    static const char* match(const char* arg, const char* prefix)
+    {
+        size_t len = std::strlen(prefix);
+        return std::strncmp(arg, prefix, len) == 0 ? arg + len : nullptr;
+    }
+};
+
+#endif // GAMEOPTIONS_H_
@@ -6,7 +6,7 @@ using namespace std;
 
 bool GameWorld::getKey(int& value)
 {
-    bool gotKey = m_controller->getLastKey(value);
+    bool gotKey = m_controller->getWorldKey(value);
 
     if (gotKey)
     {
@@ -21,7 +21,7 @@ void GameWorld::playSound(int soundID)
     m_controller->playSound(soundID);
 }
 
-void GameWorld::setGameStatText(string text)
+void GameWorld::setGameStatText(const string& text)
 {
     m_controller->setGameStatText(text);
 }
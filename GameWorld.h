@@ -2,7 +2,10 @@
 #define GAMEWORLD_H_
 
 #include "GameConstants.h"
+#include "StateHash.h"
+#include "TickEvents.h"
 #include <string>
+#include <vector>
 
 const int START_PLAYER_LIVES = 3;
 
@@ -26,7 +29,7 @@ public:
     virtual int move() = 0;
     virtual void cleanUp() = 0;
 
-    void setGameStatText(std::string text);
+    void setGameStatText(const std::string& text);
 
     bool getKey(int& value);
     void playSound(int soundID);
@@ -65,6 +68,27 @@ public:
     {
         return m_assetPath;
     }
+
+      // Hash of the complete simulation state as of the end of the last
+      // move(), and the per-object contributions it was built from.
+
+    virtual uint64_t stateHash() const
+    {
+        return 0;
+    }
+
+    virtual void stateDigests(std::vector<ActorDigest>& digests) const
+    {
+        digests.clear();
+    }
+
+      // Side effects requested during the last move(), if the world
+      // records them.
+
+    virtual const TickEventBuffer* tickEvents() const
+    {
+        return nullptr;
+    }
     
       // The following should be used by only the framework, not the student
 
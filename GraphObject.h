@@ -3,12 +3,12 @@
 
 #include "SpriteManager.h"
 #include "GameConstants.h"
+#include "DrawSnapshot.h"
 
 #include <set>
+#include <vector>
 #include <cmath>
 
-const int ANIMATION_POSITIONS_PER_TICK = 1;
-
 using Direction = int;
 
 class GraphObject
@@ -21,8 +21,10 @@ class GraphObject
     static const int down = 270;
 
     GraphObject(int imageID, double startX, double startY, Direction dir = 0, int depth = 0, double size = 1.0)
-     : m_imageID(imageID), m_x(startX), m_y(startY), m_destX(startX), m_destY(startY),
-       m_animationNumber(0), m_direction(dir), m_depth(depth), m_size(size)
+     : m_imageID(imageID), m_destX(startX), m_destY(startY),
+       m_fromX(startX), m_fromY(startY), m_movedTick(tickNumber()),
+       m_animationNumber(0), m_direction(dir), m_depth(depth), m_size(size),
+       m_static(false)
     {
         if (m_size <= 0)
             m_size = 1;
@@ -33,6 +35,8 @@ class GraphObject
     virtual ~GraphObject()
     {
         getGraphObjects(m_depth).erase(this);
+        if (m_static)
+            staticVersion()++;
     }
 
     double getX() const
@@ -49,9 +53,19 @@ class GraphObject
 
     virtual void moveTo(double x, double y)
     {
+          // Remember where this tick's motion started, for interpolation.
+        if (m_movedTick != tickNumber())
+        {
+            m_fromX = m_destX;
+            m_fromY = m_destY;
+            m_movedTick = tickNumber();
+        }
         m_destX = x;
         m_destY = y;
         increaseAnimationNumber();
+        if (m_static)
+            staticVersion()++;
+        stateChanged();
     }
 
     virtual void moveAngle(Direction angle, int units = 1)
@@ -87,11 +101,16 @@ class GraphObject
             d += 360;
 
         m_direction = d % 360;
+        if (m_static)
+            staticVersion()++;
+        stateChanged();
     }
 
     void setSize(double size)
     {
         m_size = size;
+        if (m_static)
+            staticVersion()++;
     }
 
     double getSize() const
@@ -99,6 +118,11 @@ class GraphObject
         return m_size;
     }
 
+    int getImageID() const
+    {
+        return m_imageID;
+    }
+
       // The following should be used by only the framework, not the student
 
     void increaseAnimationNumber()
@@ -106,53 +130,92 @@ class GraphObject
         m_animationNumber++;
     }
 
-    template<typename Func>
-    static void drawAllObjects(Func plotFunc)
+      // Called before each simulation tick.
+    static void beginTick()
     {
+        tickNumber()++;
+    }
+
+      // Replace items with every object in drawing order, back to front,
+      // along with where each one's motion during the last tick began.
+      // Static objects go to staticItems instead, to be drawn underneath.
+    static void captureAllObjects(std::vector<DrawItem>& items, std::vector<DrawItem>& staticItems)
+    {
+        items.clear();
+        staticItems.clear();
         for (int depth = NUM_DEPTHS - 1; depth >= 0; depth--)
         {
             for (GraphObject* go : getGraphObjects(depth))
             {
-                go->animate();
-                plotFunc(go->m_imageID, go->m_animationNumber, go->m_x, go->m_y, go->m_direction, go->m_size);
+                  // not moved during the last tick, so nothing to blend
+                bool moved = (go->m_movedTick == tickNumber());
+                DrawItem item;
+                item.imageID = go->m_imageID;
+                item.animationNumber = go->m_animationNumber;
+                item.x = static_cast<float>(go->m_destX);
+                item.y = static_cast<float>(go->m_destY);
+                item.fromX = static_cast<float>(moved ? go->m_fromX : go->m_destX);
+                item.fromY = static_cast<float>(moved ? go->m_fromY : go->m_destY);
+                item.direction = static_cast<int16_t>(go->m_direction);
+                item.depth = static_cast<int16_t>(depth);
+                item.size = static_cast<float>(go->m_size);
+                (go->m_static ? staticItems : items).push_back(item);
             }
         }
     }
 
+      // Changes whenever a static object is created, destroyed or changed,
+      // so a renderer can cache how the static objects look.
+    static uint64_t staticLayerVersion()
+    {
+        return staticVersion();
+    }
+
       // Prevent copying or assigning GraphObjects
     GraphObject(const GraphObject&) = delete;
     GraphObject& operator=(const GraphObject&) = delete;
 
+  protected:
+
+      // Called after every change of position or direction.
+    virtual void stateChanged()
+    {
+    }
+
+      // For objects that stay put and look the same from tick to tick, and
+      // are at the back: they are drawn from a cache that is rebuilt only
+      // when one of them appears, changes or goes away.
+    void setStatic()
+    {
+        m_static = true;
+        staticVersion()++;
+    }
+
   private:
 
     static const int NUM_DEPTHS = 4;
     int     m_imageID;
-    double  m_x;
-    double  m_y;
     double  m_destX;
     double  m_destY;
+    double  m_fromX;
+    double  m_fromY;
+    unsigned m_movedTick;
     int     m_animationNumber;
     Direction   m_direction;
     int     m_depth;
     double  m_size;
+    bool    m_static;
 
-    void animate()
+    static uint64_t& staticVersion()
     {
-        m_x = m_destX;
-        m_y = m_destY;
-        //moveALittle(m_x, m_destX);
-        //moveALittle(m_y, m_destY);
+        static uint64_t version = 0;
+        return version;
     }
 
-    void moveALittle(double& from, double& to)
+    static unsigned& tickNumber()
     {
-        static const double DISTANCE = 1.0/ANIMATION_POSITIONS_PER_TICK;
-        if (to - from >= DISTANCE)
-            from += DISTANCE;
-        else if (from - to >= DISTANCE)
-            from -= DISTANCE;
-        else
-            from = to;
+        static unsigned tick = 0;
+        return tick;
     }
 
     static std::set<GraphObject*>& getGraphObjects(int depth)
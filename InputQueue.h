@@ -0,0 +1,138 @@
+#ifndef INPUTQUEUE_H_
+#define INPUTQUEUE_H_
+
+#include "SpscRing.h"
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <ostream>
+
+struct InputEvent
+{
+    using Clock = std::chrono::steady_clock;
+
+    int               key = 0;
+    Clock::time_point time;         // when the window system delivered it
+};
+
+struct InputStats
+{
+    long long received = 0;
+    long long consumed = 0;         // handed to the world
+    long long dropped = 0;          // ring full
+    long long coalesced = 0;        // superseded under the latest policy
+    int       maxBacklog = 0;       // events waiting at the start of a tick
+
+    void print(std::ostream& os) const
+    {
+        os << "Input: " << received << " keys, " << consumed << " consumed, " << dropped << " dropped, "
+           << coalesced << " coalesced; backlog up to " << maxBacklog << std::endl;
+    }
+};
+
+  // Keys from the window system, queued with the time they arrived instead
+  // of overwriting one another.  The keyboard callback pushes into a
+  // lock-free ring; the thread running the game state machine drains it.
+  //
+  // Each tick sees exactly the events that had arrived when it began, so
+  // keys landing mid-tick wait for the next one.  How many of those the
+  // world gets is the policy: under queue, the world takes the oldest, one
+  // a tick, and the rest carry over; under latest, only the newest is kept,
+  // as when a single key slot was overwritten.
+
+class InputQueue
+{
+  public:
+    enum Policy { queue, latest };
+
+    static const size_t CAPACITY = 64;
+
+    InputQueue()
+     : m_policy(queue), m_dropped(0)
+    {
+    }
+
+    void configure(Policy policy)
+    {
+        m_policy = policy;
+    }
+
+      // Producer: the keyboard callback.
+    void push(int key)
+    {
+        InputEvent event;
+        event.key = key;
+        event.time = InputEvent::Clock::now();
+        if (!m_ring.push(event))
+            m_dropped++;
+    }
+
+      // Consumer: start of a tick.
+    void beginTick()
+    {
+        takeArrived();
+        m_stats.maxBacklog = std::max(m_stats.maxBacklog, static_cast<int>(m_pending.size()));
+        if (m_policy == latest  &&  m_pending.size() > 1)
+        {
+            m_stats.coalesced += m_pending.size() - 1;
+            m_pending.erase(m_pending.begin(), m_pending.end() - 1);
+        }
+    }
+
+      // Consumer: the world's key for this tick, the oldest that had arrived
+      // when the tick began.
+    bool next(InputEvent& event)
+    {
+        if (m_pending.empty())
+            return false;
+        event = m_pending.front();
+        m_pending.erase(m_pending.begin());
+        m_stats.consumed++;
+        return true;
+    }
+
+      // Consumer, outside ticks (prompts, single-stepping): the oldest event
+      // of any, whenever it arrived.
+    bool pop(InputEvent& event)
+    {
+        takeArrived();
+        if (m_pending.empty())
+            return false;
+        event = m_pending.front();
+        m_pending.erase(m_pending.begin());
+        return true;
+    }
+
+      // Consumer: whether any event has arrived and not been taken.
+    bool hasPending() const
+    {
+        return !m_pending.empty()  ||  !m_ring.empty();
+    }
+
+    InputStats stats() const
+    {
+        InputStats s = m_stats;
+        s.dropped = m_dropped.load(std::memory_order_relaxed);
+        return s;
+    }
+
+  private:
+    SpscRing<InputEvent, CAPACITY> m_ring;
+    std::vector<InputEvent>        m_pending;  // arrived, not yet consumed; consumer only
+    Policy                         m_policy;
+    std::atomic<long long>         m_dropped;
+    InputStats                     m_stats;    // consumer only, but for dropped
+
+    void takeArrived()
+    {
+        InputEvent event;
+        while (m_ring.pop(event))
+        {
+            m_pending.push_back(event);
+            m_stats.received++;
+        }
+    }
+};
+
+#endif // INPUTQUEUE_H_
@@ -0,0 +1,77 @@
+#ifndef LATENCYHISTOGRAM_H_
+#define LATENCYHISTOGRAM_H_
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstddef>
+
+  // Durations counted into fixed-width buckets, BUCKET_US wide up to
+  // MAX_MS and one overflow bucket beyond, so recording is an increment
+  // and percentiles are read off to within a bucket.
+
+class LatencyHistogram
+{
+  public:
+    static const int BUCKET_US = 100;
+    static const int MAX_MS = 500;
+    static const int NUM_BUCKETS = MAX_MS * 1000 / BUCKET_US + 1;
+
+    LatencyHistogram()
+     : m_buckets(NUM_BUCKETS, 0), m_count(0), m_totalUs(0), m_maxUs(0)
+    {
+    }
+
+    void record(double ms)
+    {
+        long long us = std::max(0LL, static_cast<long long>(ms * 1000));
+        m_buckets[static_cast<size_t>(std::min<long long>(us / BUCKET_US, NUM_BUCKETS - 1))]++;
+        m_count++;
+        m_totalUs += us;
+        m_maxUs = std::max(m_maxUs, us);
+    }
+
+    long long count() const
+    {
+        return m_count;
+    }
+
+      // the upper edge of the bucket holding the p-th percentile, in ms
+    double percentileMs(double p) const
+    {
+        if (m_count == 0)
+            return 0;
+        long long rank = static_cast<long long>(p / 100 * m_count + 0.5);
+        rank = std::min(std::max(rank, 1LL), m_count);
+        long long seen = 0;
+        for (int b = 0; b < NUM_BUCKETS; b++)
+        {
+            seen += m_buckets[b];
+            if (seen >= rank)
+                return std::min(static_cast<long long>(b + 1) * BUCKET_US, m_maxUs) / 1000.0;
+        }
+        return m_maxUs / 1000.0;
+    }
+
+    void print(std::ostream& os, const std::string& name) const
+    {
+        os << std::fixed << std::setprecision(1) << "  " << std::left << std::setw(14) << name << std::right
+           << m_count << " samples";
+        if (m_count > 0)
+        {
+            os << ", avg " << m_totalUs / 1000.0 / m_count << " ms, p50 " << percentileMs(50)
+               << " ms, p99 " << percentileMs(99) << " ms, max " << m_maxUs / 1000.0 << " ms";
+        }
+        os << std::endl;
+    }
+
+  private:
+    std::vector<long long> m_buckets;
+    long long              m_count;
+    long long              m_totalUs;
+    long long              m_maxUs;
+};
+
+#endif // LATENCYHISTOGRAM_H_
@@ -0,0 +1,196 @@
+#include "Replay.h"
+#include "GameWorld.h"
+#include "GameController.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+using namespace std;
+
+static const char REPLAY_MAGIC[4] = { 'K', 'R', 'P', 'L' };
+static const uint32_t REPLAY_VERSION = 2;
+
+template<typename T>
+static void writeValue(fstream& f, const T& value)
+{
+    f.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+static bool readValue(fstream& f, T& value)
+{
+    f.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return static_cast<bool>(f);
+}
+
+static string hexString(uint64_t value)
+{
+    ostringstream oss;
+    oss << hex << setw(16) << setfill('0') << value;
+    return oss.str();
+}
+
+Replay::Replay()
+ : m_mode(none), m_tick(0), m_key(INVALID_KEY), m_expectedHash(0),
+   m_expectedEventHash(0), m_diverged(false)
+{
+}
+
+bool Replay::startRecording(const string& fileName, unsigned seed)
+{
+    m_file.open(fileName, ios::out | ios::binary | ios::trunc);
+    if (!m_file)
+    {
+        cout << "Cannot create replay file " << fileName << endl;
+        return false;
+    }
+    m_file.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    writeValue(m_file, REPLAY_VERSION);
+    writeValue(m_file, static_cast<uint32_t>(seed));
+    m_mode = recording;
+    m_key = INVALID_KEY;
+    return true;
+}
+
+bool Replay::startPlayback(const string& fileName, unsigned& seed)
+{
+    m_file.open(fileName, ios::in | ios::binary);
+    if (!m_file)
+    {
+        cout << "Cannot open replay file " << fileName << endl;
+        return false;
+    }
+    char magic[sizeof(REPLAY_MAGIC)];
+    uint32_t version;
+    uint32_t storedSeed;
+    m_file.read(magic, sizeof(magic));
+    if (!m_file  ||  !equal(magic, magic + sizeof(magic), REPLAY_MAGIC)  ||
+        !readValue(m_file, version)  ||  version != REPLAY_VERSION  ||
+        !readValue(m_file, storedSeed))
+    {
+        cout << fileName << " is not a replay file" << endl;
+        return false;
+    }
+    seed = storedSeed;
+    m_mode = playing;
+    return true;
+}
+
+bool Replay::beginTick()
+{
+    if (m_mode != playing)
+        return true;
+
+    uint32_t tick;
+    uint32_t count;
+    if (!readValue(m_file, tick)  ||  !readValue(m_file, m_key)  ||
+        !readValue(m_file, m_expectedHash)  ||  !readValue(m_file, m_expectedEventHash)  ||
+        !readValue(m_file, count))
+        return false;
+    m_expected.resize(count);
+    for (ActorDigest& d : m_expected)
+    {
+        if (!readValue(m_file, d.serial)  ||  !readValue(m_file, d.imageID)  ||
+            !readValue(m_file, d.digest))
+            return false;
+    }
+    return true;
+}
+
+void Replay::noteKey(int key)
+{
+    if (m_mode == recording)
+        m_key = key;
+}
+
+bool Replay::keyForTick(int& key) const
+{
+    if (m_key == INVALID_KEY)
+        return false;
+    key = m_key;
+    return true;
+}
+
+void Replay::endTick(const GameWorld& gw)
+{
+    if (m_mode == none)
+        return;
+
+    uint64_t hash = gw.stateHash();
+    const TickEventBuffer* events = gw.tickEvents();
+    uint64_t eventHash = (events != nullptr ? events->hash() : 0);
+    if (m_mode == recording)
+    {
+        gw.stateDigests(m_actual);
+        writeValue(m_file, m_tick);
+        writeValue(m_file, m_key);
+        writeValue(m_file, hash);
+        writeValue(m_file, eventHash);
+        writeValue(m_file, static_cast<uint32_t>(m_actual.size()));
+        for (const ActorDigest& d : m_actual)
+        {
+            writeValue(m_file, d.serial);
+            writeValue(m_file, d.imageID);
+            writeValue(m_file, d.digest);
+        }
+        m_key = INVALID_KEY;
+    }
+    else if ((hash != m_expectedHash  ||  eventHash != m_expectedEventHash)  &&  !m_diverged)
+    {
+        m_diverged = true;
+        gw.stateDigests(m_actual);
+        reportDivergence(hash, eventHash);
+    }
+    m_tick++;
+}
+
+void Replay::reportDivergence(uint64_t hash, uint64_t eventHash)
+{
+    if (hash == m_expectedHash)
+    {
+        cout << "Replay diverged at tick " << m_tick << ": state matches but the tick's events hash to "
+             << hexString(eventHash) << ", expected " << hexString(m_expectedEventHash) << endl;
+        return;
+    }
+    cout << "Replay diverged at tick " << m_tick << ": state hash "
+         << hexString(hash) << ", expected " << hexString(m_expectedHash) << endl;
+
+    size_t k = 0;
+    for ( ; k < m_expected.size()  &&  k < m_actual.size(); k++)
+    {
+        const ActorDigest& e = m_expected[k];
+        const ActorDigest& a = m_actual[k];
+        if (e.serial != a.serial)
+        {
+            cout << "  first divergent actor: #" << e.serial << " (image " << e.imageID
+                 << ") expected, found #" << a.serial << " (image " << a.imageID << ")" << endl;
+            return;
+        }
+        if (e.digest != a.digest)
+        {
+            cout << "  first divergent actor: #" << a.serial << " (image " << a.imageID
+                 << ") digest " << hexString(a.digest) << ", expected " << hexString(e.digest) << endl;
+            return;
+        }
+    }
+    if (k < m_expected.size())
+        cout << "  first divergent actor: #" << m_expected[k].serial << " (image "
+             << m_expected[k].imageID << ") is missing" << endl;
+    else if (k < m_actual.size())
+        cout << "  first divergent actor: #" << m_actual[k].serial << " (image "
+             << m_actual[k].imageID << ") was not in the recording" << endl;
+    else
+        cout << "  all actors match; score, lives, level or counters differ" << endl;
+}
+
+void Replay::finish()
+{
+    if (m_mode == playing)
+    {
+        if (!m_diverged)
+            cout << "Replay verified: " << m_tick << " ticks, no divergence" << endl;
+    }
+    if (m_file.is_open())
+        m_file.close();
+    m_mode = none;
+}
@@ -0,0 +1,76 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "StateHash.h"
+#include <string>
+#include <fstream>
+#include <vector>
+#include <cstdint>
+
+class GameWorld;
+
+  // Records a session as its random seed plus, for every tick, the key the
+  // world consumed, a hash of the side effects it requested, and the
+  // resulting state hash with per-actor digests.  Playing a replay back
+  // feeds the recorded keys to the world and compares the hashes after
+  // every tick, reporting the first divergent tick and actor.  Files are
+  // written in host byte order.
+
+class Replay
+{
+  public:
+    Replay();
+
+    bool startRecording(const std::string& fileName, unsigned seed);
+    bool startPlayback(const std::string& fileName, unsigned& seed);
+
+    bool isRecording() const
+    {
+        return m_mode == recording;
+    }
+
+    bool isPlaying() const
+    {
+        return m_mode == playing;
+    }
+
+    bool diverged() const
+    {
+        return m_diverged;
+    }
+
+    uint32_t tick() const
+    {
+        return m_tick;
+    }
+
+      // Playback: load the record for the next tick.  Returns false once the
+      // replay is exhausted.
+    bool beginTick();
+
+      // The key the world consumes this tick, recorded or played back.
+    void noteKey(int key);
+    bool keyForTick(int& key) const;
+
+      // Record or verify the world's state at the end of the tick.
+    void endTick(const GameWorld& gw);
+
+    void finish();
+
+  private:
+    enum Mode { none, recording, playing };
+
+    Mode         m_mode;
+    std::fstream m_file;
+    uint32_t     m_tick;
+    int32_t      m_key;
+    uint64_t     m_expectedHash;
+    uint64_t     m_expectedEventHash;
+    bool         m_diverged;
+    std::vector<ActorDigest> m_expected;
+    std::vector<ActorDigest> m_actual;
+
+    void reportDivergence(uint64_t hash, uint64_t eventHash);
+};
+
+#endif // REPLAY_H_
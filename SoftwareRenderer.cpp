@@ -0,0 +1,348 @@
+#include "SoftwareRenderer.h"
+#include "GameConstants.h"
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_RENDERER_SSE2 1
+#endif
+
+using namespace std;
+
+  // Pixels are packed little-endian, so alpha is the top byte.
+static const uint32_t OPAQUE_BLACK = 0xff000000;
+static const uint32_t RIM_COLOR = 0xff999999;     // the HUD's resting grey
+
+static uint32_t pack(unsigned r, unsigned g, unsigned b, unsigned a)
+{
+    return r | g << 8 | b << 16 | static_cast<uint32_t>(a) << 24;
+}
+
+static unsigned channel(uint32_t pixel, int c)
+{
+    return pixel >> (8 * c) & 0xff;
+}
+
+  // x / 255, rounded, for x up to 255 * 255
+static unsigned div255(unsigned x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+SoftwareRenderer::SoftwareRenderer()
+ : m_pixels(WIDTH * HEIGHT, OPAQUE_BLACK), m_staticVersion(0), m_staticValid(false)
+{
+}
+
+bool SoftwareRenderer::loadSprite(const string& tgaFile, int imageID, int frameNum)
+{
+    TgaImage image;
+    if (!image.load(tgaFile))
+        return false;
+    return addSprite(image.view(), imageID, frameNum);
+}
+
+bool SoftwareRenderer::addSprite(const ImageView& image, int imageID, int frameNum)
+{
+    if (imageID < 0  ||  frameNum < 0  ||  frameNum >= MAX_FRAMES  ||  image.empty())
+        return false;
+
+    size_t index = static_cast<size_t>(imageID) * MAX_FRAMES + frameNum;
+    if (index >= m_sprites.size())
+        m_sprites.resize(index + 1);
+    if (imageID >= static_cast<int>(m_numFrames.size()))
+        m_numFrames.resize(imageID + 1, 0);
+
+    Sprite& sprite = m_sprites[index];
+    if (!sprite.loaded)
+        m_numFrames[imageID]++;
+    int width = static_cast<int>(lround(SPRITE_WIDTH * pixelsPerUnit()));
+    int height = static_cast<int>(lround(SPRITE_HEIGHT * pixelsPerUnit()));
+    sprite.scaled = scale(image, width, height);
+    sprite.rotated.assign(360, Bitmap());
+    sprite.loaded = true;
+    return true;
+}
+
+int SoftwareRenderer::getNumFrames(int imageID) const
+{
+    if (imageID < 0  ||  imageID >= static_cast<int>(m_numFrames.size()))
+        return 0;
+    return m_numFrames[imageID];
+}
+
+void SoftwareRenderer::clear()
+{
+    fill(m_pixels.begin(), m_pixels.end(), OPAQUE_BLACK);
+}
+
+bool SoftwareRenderer::plotSprite(int imageID, int frame, double x, double y, int angleDegrees, double size, int)
+{
+    if (imageID < 0  ||  frame < 0  ||  frame >= MAX_FRAMES)
+        return false;
+    size_t index = static_cast<size_t>(imageID) * MAX_FRAMES + frame;
+    if (index >= m_sprites.size()  ||  !m_sprites[index].loaded)
+        return false;
+    Sprite& sprite = m_sprites[index];
+
+    int angle = angleDegrees % 360;
+    if (angle < 0)
+        angle += 360;
+
+    const Bitmap* bitmap;
+    if (size == 1)
+    {
+        Bitmap& rotated = sprite.rotated[angle];
+        if (rotated.pixels.empty())
+            rotate(sprite.scaled, angle, rotated);
+        bitmap = &rotated;
+    }
+    else
+    {
+          // uncommon, so not cached: rescale the scaled copy, then rotate
+        Bitmap resized;
+        resized.width = max(1, static_cast<int>(lround(sprite.scaled.width * size)));
+        resized.height = max(1, static_cast<int>(lround(sprite.scaled.height * size)));
+        resized.pixels.resize(static_cast<size_t>(resized.width) * resized.height);
+        for (int r = 0; r < resized.height; r++)
+        {
+            int sr = r * sprite.scaled.height / resized.height;
+            for (int c = 0; c < resized.width; c++)
+                resized.pixels[static_cast<size_t>(r) * resized.width + c] =
+                    sprite.scaled.pixels[static_cast<size_t>(sr) * sprite.scaled.width + c * sprite.scaled.width / resized.width];
+        }
+        rotate(resized, angle, m_scratch);
+        bitmap = &m_scratch;
+    }
+
+    double px, py;
+    toPixels(x, y, px, py);
+    blit(*bitmap, static_cast<int>(lround(px - bitmap->width / 2.0)),
+                  static_cast<int>(lround(py - bitmap->height / 2.0)));
+    return true;
+}
+
+void SoftwareRenderer::drawCircle(float cx, float cy, float r, int numSegments)
+{
+    const double PI = 4 * atan(1.0);
+    for (int k = 0; k < numSegments; k++)
+    {
+        double theta0 = 2 * PI * k / numSegments;
+        double theta1 = 2 * PI * (k + 1) / numSegments;
+        double x0, y0, x1, y1;
+        toPixels(cx + r * cos(theta0), cy + r * sin(theta0), x0, y0);
+        toPixels(cx + r * cos(theta1), cy + r * sin(theta1), x1, y1);
+        int steps = max(1, static_cast<int>(ceil(max(fabs(x1 - x0), fabs(y1 - y0)))));
+        for (int s = 0; s <= steps; s++)
+        {
+            double t = static_cast<double>(s) / steps;
+            plotPixel(static_cast<int>(lround(x0 + (x1 - x0) * t)),
+                      static_cast<int>(lround(y0 + (y1 - y0) * t)), RIM_COLOR);
+        }
+    }
+}
+
+bool SoftwareRenderer::drawStaticLayer(uint64_t version)
+{
+    if (!m_staticValid  ||  version != m_staticVersion)
+        return false;
+    copy(m_staticPixels.begin(), m_staticPixels.end(), m_pixels.begin());
+    return true;
+}
+
+void SoftwareRenderer::captureStaticLayer(uint64_t version)
+{
+    m_staticPixels = m_pixels;
+    m_staticVersion = version;
+    m_staticValid = true;
+}
+
+bool SoftwareRenderer::writeTga(const string& fileName) const
+{
+    ofstream out(fileName, ios::out|ios::binary|ios::trunc);
+    if (!out)
+        return false;
+    unsigned char header[18] = { 0 };
+    header[2] = 2;                      // uncompressed true color
+    header[12] = WIDTH & 0xff;
+    header[13] = WIDTH >> 8;
+    header[14] = HEIGHT & 0xff;
+    header[15] = HEIGHT >> 8;
+    header[16] = 32;
+    header[17] = 0x28;                  // 8 alpha bits, top row first
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    vector<unsigned char> row(WIDTH * 4);
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        const uint32_t* p = &m_pixels[static_cast<size_t>(y) * WIDTH];
+        for (int x = 0; x < WIDTH; x++)
+        {
+            row[4*x]   = static_cast<unsigned char>(channel(p[x], 2));
+            row[4*x+1] = static_cast<unsigned char>(channel(p[x], 1));
+            row[4*x+2] = static_cast<unsigned char>(channel(p[x], 0));
+            row[4*x+3] = static_cast<unsigned char>(channel(p[x], 3));
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(out);
+}
+
+  // Box-filter the image down (or up) to width x height, premultiplying
+  // alpha and flipping it to top row first.
+SoftwareRenderer::Bitmap SoftwareRenderer::scale(const ImageView& image, int width, int height)
+{
+    Bitmap out;
+    out.width = width;
+    out.height = height;
+    out.pixels.resize(static_cast<size_t>(width) * height);
+    int sw = image.width, sh = image.height;
+    for (int y = 0; y < height; y++)
+    {
+        int top0 = y * sh / height;
+        int top1 = max(top0 + 1, (y + 1) * sh / height);
+        for (int x = 0; x < width; x++)
+        {
+            int x0 = x * sw / width;
+            int x1 = max(x0 + 1, (x + 1) * sw / width);
+            unsigned long long sum[4] = { 0, 0, 0, 0 };
+            for (int top = top0; top < top1; top++)
+            {
+                const unsigned char* p = &image.bgra[(static_cast<size_t>(sh - 1 - top) * sw + x0) * 4];
+                for (int sx = x0; sx < x1; sx++, p += 4)
+                {
+                    unsigned a = p[3];
+                    sum[0] += p[2] * a;
+                    sum[1] += p[1] * a;
+                    sum[2] += p[0] * a;
+                    sum[3] += a;
+                }
+            }
+            unsigned long long n = static_cast<unsigned long long>(top1 - top0) * (x1 - x0);
+            out.pixels[static_cast<size_t>(y) * width + x] =
+                pack(static_cast<unsigned>((sum[0] + n * 255 / 2) / (n * 255)),
+                     static_cast<unsigned>((sum[1] + n * 255 / 2) / (n * 255)),
+                     static_cast<unsigned>((sum[2] + n * 255 / 2) / (n * 255)),
+                     static_cast<unsigned>((sum[3] + n / 2) / n));
+        }
+    }
+    return out;
+}
+
+  // Rotate counterclockwise about the center with bilinear filtering.  As
+  // in SpriteManager, 180 degrees is a left-right reflection instead.
+void SoftwareRenderer::rotate(const Bitmap& source, int angleDegrees, Bitmap& out)
+{
+    int w = source.width, h = source.height;
+    if (angleDegrees == 180)
+    {
+        out = source;
+        for (int y = 0; y < h; y++)
+            std::reverse(out.pixels.begin() + static_cast<size_t>(y) * w,
+                         out.pixels.begin() + static_cast<size_t>(y + 1) * w);
+        return;
+    }
+
+    const double PI = 4 * atan(1.0);
+    double theta = angleDegrees * PI / 180;
+    double c = cos(theta), s = sin(theta);
+    out.width = static_cast<int>(ceil(fabs(w * c) + fabs(h * s) - 1e-9));
+    out.height = static_cast<int>(ceil(fabs(w * s) + fabs(h * c) - 1e-9));
+    out.pixels.assign(static_cast<size_t>(out.width) * out.height, 0);
+
+    auto at = [&source, w, h](int x, int y) -> uint32_t
+    {
+        return (x < 0  ||  y < 0  ||  x >= w  ||  y >= h) ? 0 : source.pixels[static_cast<size_t>(y) * w + x];
+    };
+    for (int oy = 0; oy < out.height; oy++)
+    {
+        for (int ox = 0; ox < out.width; ox++)
+        {
+              // y grows upward here, so positive angles turn counterclockwise
+            double dx = ox + 0.5 - out.width / 2.0;
+            double dy = out.height / 2.0 - (oy + 0.5);
+            double u = dx * c + dy * s;
+            double v = -dx * s + dy * c;
+            double sx = u + w / 2.0 - 0.5;
+            double sy = h / 2.0 - v - 0.5;
+            int x0 = static_cast<int>(floor(sx));
+            int y0 = static_cast<int>(floor(sy));
+            double fx = sx - x0, fy = sy - y0;
+            uint32_t p00 = at(x0, y0), p10 = at(x0 + 1, y0), p01 = at(x0, y0 + 1), p11 = at(x0 + 1, y0 + 1);
+            unsigned ch[4];
+            for (int k = 0; k < 4; k++)
+            {
+                double top = channel(p00, k) * (1 - fx) + channel(p10, k) * fx;
+                double bottom = channel(p01, k) * (1 - fx) + channel(p11, k) * fx;
+                ch[k] = static_cast<unsigned>(lround(top * (1 - fy) + bottom * fy));
+            }
+            out.pixels[static_cast<size_t>(oy) * out.width + ox] = pack(ch[0], ch[1], ch[2], ch[3]);
+        }
+    }
+}
+
+  // Premultiplied "over": dst = src + dst * (255 - src alpha) / 255.
+void SoftwareRenderer::blit(const Bitmap& bitmap, int left, int top)
+{
+    int x0 = max(0, -left), x1 = min(bitmap.width, WIDTH - left);
+    int y0 = max(0, -top), y1 = min(bitmap.height, HEIGHT - top);
+    if (x0 >= x1)
+        return;
+    for (int y = y0; y < y1; y++)
+    {
+        const uint32_t* src = &bitmap.pixels[static_cast<size_t>(y) * bitmap.width + x0];
+        uint32_t* dst = &m_pixels[static_cast<size_t>(top + y) * WIDTH + left + x0];
+        int n = x1 - x0;
+        int k = 0;
+#ifdef SOFTWARE_RENDERER_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i all255 = _mm_set1_epi32(255);
+        const __m128i round = _mm_set1_epi16(128);
+        for (; k + 4 <= n; k += 4)
+        {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + k));
+            __m128i inv = _mm_sub_epi32(all255, _mm_srli_epi32(s, 24));
+            inv = _mm_or_si128(inv, _mm_slli_epi32(inv, 16));   // both halves of each pixel
+            __m128i invLo = _mm_unpacklo_epi32(inv, inv);
+            __m128i invHi = _mm_unpackhi_epi32(inv, inv);
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), invLo), round);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), invHi), round);
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+            __m128i blended = _mm_adds_epu8(_mm_packus_epi16(lo, hi), s);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k), blended);
+        }
+#endif
+        for (; k < n; k++)
+        {
+            uint32_t s = src[k];
+            unsigned inv = 255 - (s >> 24);
+            uint32_t d = dst[k];
+            dst[k] = pack(min(255u, channel(s, 0) + div255(channel(d, 0) * inv)),
+                          min(255u, channel(s, 1) + div255(channel(d, 1) * inv)),
+                          min(255u, channel(s, 2) + div255(channel(d, 2) * inv)),
+                          min(255u, channel(s, 3) + div255(channel(d, 3) * inv)));
+        }
+    }
+}
+
+void SoftwareRenderer::plotPixel(int x, int y, uint32_t color)
+{
+    if (x >= 0  &&  y >= 0  &&  x < WIDTH  &&  y < HEIGHT)
+        m_pixels[static_cast<size_t>(y) * WIDTH + x] = color;
+}
+
+  // The dish and its rim, with a sprite's width to spare on each side.
+double SoftwareRenderer::pixelsPerUnit()
+{
+    return static_cast<double>(WIDTH) / (VIEW_WIDTH + 4 * SPRITE_WIDTH);
+}
+
+void SoftwareRenderer::toPixels(double x, double y, double& px, double& py)
+{
+    px = (x + 2 * SPRITE_WIDTH) * pixelsPerUnit();
+    py = HEIGHT - (y + 2 * SPRITE_HEIGHT) * pixelsPerUnit();
+}
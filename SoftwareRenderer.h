@@ -0,0 +1,88 @@
+#ifndef SOFTWARERENDERER_H_
+#define SOFTWARERENDERER_H_
+
+#include "TgaImage.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+  // Draws sprites into an in-memory RGBA framebuffer with nothing but the
+  // CPU, for machines with no display or GPU.  It offers the drawing calls
+  // of SpriteManager that the game uses, so the same code can drive either.
+  //
+  // Sprites are scaled once when loaded; each frame's rotation to a given
+  // whole-degree angle is made the first time it is needed and kept, so a
+  // frame is mostly straight alpha blits of premultiplied pixels.
+
+class SoftwareRenderer
+{
+  public:
+    static const int WIDTH = 768;
+    static const int HEIGHT = 768;
+
+    SoftwareRenderer();
+
+    bool loadSprite(const std::string& tgaFile, int imageID, int frameNum);
+    bool addSprite(const ImageView& image, int imageID, int frameNum);
+    int getNumFrames(int imageID) const;
+
+    void clear();
+
+      // As SpriteManager::plotSprite, but drawn at once; depth is ignored
+      // since callers already plot back to front.
+    bool plotSprite(int imageID, int frame, double x, double y, int angleDegrees, double size, int depth = 0);
+
+    void flushSprites()
+    {
+    }
+
+    void drawCircle(float cx, float cy, float r, int numSegments);
+
+      // Same contract as SpriteManager's static layer cache.
+    bool drawStaticLayer(uint64_t version);
+    void captureStaticLayer(uint64_t version);
+
+      // WIDTH * HEIGHT pixels, top row first, each R, G, B, A in memory order.
+    const uint32_t* pixels() const
+    {
+        return m_pixels.data();
+    }
+
+    bool writeTga(const std::string& fileName) const;
+
+  private:
+      // premultiplied pixels, laid out like the framebuffer
+    struct Bitmap
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<uint32_t> pixels;
+    };
+
+    struct Sprite
+    {
+        Bitmap              scaled;     // upright, at the size drawn for size 1
+        std::vector<Bitmap> rotated;    // by angle in degrees, made on demand
+        bool                loaded = false;
+    };
+
+    std::vector<uint32_t> m_pixels;
+    std::vector<uint32_t> m_staticPixels;
+    uint64_t              m_staticVersion;
+    bool                  m_staticValid;
+    std::vector<Sprite>   m_sprites;    // by image ID * MAX_FRAMES + frame
+    std::vector<int>      m_numFrames;  // by image ID
+    Bitmap                m_scratch;    // for sizes other than 1
+
+    static const int MAX_FRAMES = 100;
+
+    static Bitmap scale(const ImageView& image, int width, int height);
+    static void rotate(const Bitmap& source, int angleDegrees, Bitmap& out);
+    void blit(const Bitmap& bitmap, int left, int top);
+    void plotPixel(int x, int y, uint32_t color);
+
+    static double pixelsPerUnit();
+    static void toPixels(double x, double y, double& px, double& py);
+};
+
+#endif // SOFTWARERENDERER_H_
@@ -0,0 +1,156 @@
+#ifndef SOUNDBANK_H_
+#define SOUNDBANK_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+
+  // A decoded WAV file: interleaved PCM samples, either unsigned 8-bit or
+  // signed 16-bit little-endian, as stored in the file.  The samples are
+  // either owned (data) or borrowed from an asset bundle mapped into memory
+  // (mapped), which must then outlive the clip.
+
+struct PcmClip
+{
+    int               channels = 0;
+    int               sampleRate = 0;
+    int               bitsPerSample = 0;
+    std::vector<char> data;
+    const char*       mapped = nullptr;
+    size_t            mappedSize = 0;
+    std::string       path;         // where it was loaded from
+
+    const char* samples() const
+    {
+        return mapped != nullptr ? mapped : data.data();
+    }
+
+    size_t sampleBytes() const
+    {
+        return mapped != nullptr ? mappedSize : data.size();
+    }
+
+    int frameCount() const
+    {
+        int frameSize = channels * bitsPerSample / 8;
+        return frameSize > 0 ? static_cast<int>(sampleBytes() / frameSize) : 0;
+    }
+
+    double durationMs() const
+    {
+        return sampleRate > 0 ? 1000.0 * frameCount() / sampleRate : 0;
+    }
+
+    bool empty() const
+    {
+        return sampleBytes() == 0;
+    }
+
+      // Parse a RIFF/WAVE file holding uncompressed PCM.  Chunks other than
+      // "fmt " and "data" (JUNK, LIST, ...) are skipped.
+    bool loadWav(const std::string& fileName)
+    {
+        std::ifstream wavFile(fileName, std::ios::in|std::ios::binary);
+        if (!wavFile)
+            return false;
+
+        char riff[12];
+        wavFile.read(riff, sizeof(riff));
+        if (!wavFile  ||  std::memcmp(riff, "RIFF", 4) != 0  ||  std::memcmp(riff + 8, "WAVE", 4) != 0)
+            return false;
+
+        bool haveFormat = false;
+        char chunkHeader[8];
+        while (wavFile.read(chunkHeader, sizeof(chunkHeader)))
+        {
+            uint32_t chunkSize = readLE32(chunkHeader + 4);
+            if (std::memcmp(chunkHeader, "fmt ", 4) == 0)
+            {
+                char fmt[16];
+                if (chunkSize < sizeof(fmt)  ||  !wavFile.read(fmt, sizeof(fmt)))
+                    return false;
+                int formatTag = readLE16(fmt);
+                channels = readLE16(fmt + 2);
+                sampleRate = static_cast<int>(readLE32(fmt + 4));
+                bitsPerSample = readLE16(fmt + 14);
+                if (formatTag != 1  ||  channels < 1  ||  channels > 2  ||
+                    (bitsPerSample != 8  &&  bitsPerSample != 16)  ||  sampleRate <= 0)
+                    return false;
+                haveFormat = true;
+                wavFile.seekg(chunkSize - sizeof(fmt) + (chunkSize & 1), std::ios::cur);
+            }
+            else if (std::memcmp(chunkHeader, "data", 4) == 0)
+            {
+                if (!haveFormat)
+                    return false;
+                data.resize(chunkSize);
+                wavFile.read(data.data(), chunkSize);
+                  // tolerate files whose data chunk claims more than is there
+                data.resize(static_cast<size_t>(wavFile.gcount()));
+                int frameSize = channels * bitsPerSample / 8;
+                data.resize(data.size() / frameSize * frameSize);
+                path = fileName;
+                return !data.empty();
+            }
+            else
+                wavFile.seekg(chunkSize + (chunkSize & 1), std::ios::cur);
+        }
+        return false;
+    }
+
+  private:
+    static unsigned int readLE16(const char* p)
+    {
+        return static_cast<unsigned char>(p[0]) | static_cast<unsigned char>(p[1]) << 8;
+    }
+
+    static uint32_t readLE32(const char* p)
+    {
+        return readLE16(p) | static_cast<uint32_t>(readLE16(p + 2)) << 16;
+    }
+};
+
+  // Every sound the game uses, decoded once at startup and indexed by sound
+  // ID, so that playing one is an array lookup with no file access.
+
+class SoundBank
+{
+  public:
+    bool load(int soundID, const std::string& fileName)
+    {
+        PcmClip clip;
+        if (!clip.loadWav(fileName))
+            return false;
+        return add(soundID, std::move(clip));
+    }
+
+    bool add(int soundID, PcmClip clip)
+    {
+        if (soundID < 0  ||  clip.empty())
+            return false;
+        if (soundID >= static_cast<int>(m_clips.size()))
+            m_clips.resize(soundID + 1);
+        m_clips[soundID] = std::move(clip);
+        return true;
+    }
+
+      // nullptr if the ID is unknown or its file could not be loaded
+    const PcmClip* clip(int soundID) const
+    {
+        if (soundID < 0  ||  soundID >= static_cast<int>(m_clips.size())  ||  m_clips[soundID].empty())
+            return nullptr;
+        return &m_clips[soundID];
+    }
+
+    int size() const
+    {
+        return static_cast<int>(m_clips.size());
+    }
+
+  private:
+    std::vector<PcmClip> m_clips;
+};
+
+#endif // SOUNDBANK_H_
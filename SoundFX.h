@@ -1,7 +1,23 @@
 #ifndef SOUNDFX_H_
 #define SOUNDFX_H_
 
+#include "SoundBank.h"
+#include "VoiceManager.h"
 #include <string>
+#include <vector>
+#include <chrono>
+
+  // Each controller is given the decoded clips once at startup through
+  // registerClip, after which playClip(soundID) does no allocation and no
+  // file I/O on the platforms that can play from memory.  Every backend
+  // admits sounds through a VoiceManager, configured with setPolicy before
+  // the clips are played, so floods of one sound can't starve the others.
+
+inline double soundClockMs()
+{
+    return std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
 #if defined(_MSC_VER)
 
@@ -13,24 +29,74 @@ class SoundFXController
 {
   public:
 
-    void playClip(std::string soundFile)
+    void registerClip(int soundID, const PcmClip& clip)
     {
-        if (m_engine != nullptr)
-            m_engine->play2D(soundFile.c_str(), false);
+        if (m_engine == nullptr  ||  soundID < 0)
+            return;
+        irrklang::SAudioStreamFormat format;
+        format.ChannelCount = clip.channels;
+        format.FrameCount = clip.frameCount();
+        format.SampleRate = clip.sampleRate;
+        format.SampleFormat = (clip.bitsPerSample == 8 ? irrklang::ESF_U8 : irrklang::ESF_S16);
+        std::string name = "sound" + std::to_string(soundID) + ".wav";
+        if (soundID >= static_cast<int>(m_sources.size()))
+            m_sources.resize(soundID + 1, nullptr);
+        m_sources[soundID] = m_engine->addSoundSourceFromPCMData(
+                    const_cast<char*>(clip.samples()), static_cast<irrklang::ik_s32>(clip.sampleBytes()),
+                    name.c_str(), format);
+        m_voiceManager.setDuration(soundID, clip.durationMs());
+    }
+
+    void setPolicy(int soundID, const VoicePolicy& policy)
+    {
+        m_voiceManager.setPolicy(soundID, policy);
+    }
+
+    void playClip(int soundID)
+    {
+        if (m_engine == nullptr  ||  soundID < 0  ||  soundID >= static_cast<int>(m_sources.size())  ||
+            m_sources[soundID] == nullptr)
+            return;
+        bool stolen;
+        int v = m_voiceManager.acquire(soundID, soundClockMs(), stolen);
+        if (v == VoiceManager::NO_VOICE)
+            return;
+        releaseVoice(v, stolen);
+        m_playing[v] = m_engine->play2D(m_sources[soundID], false, false, true);
     }
 
     void abortClip()
     {
-        if (m_engine != nullptr)
-            m_engine->stopAllSounds();
+        if (m_engine == nullptr)
+            return;
+        m_engine->stopAllSounds();
+        for (int v = 0; v < NUM_VOICES; v++)
+            releaseVoice(v, false);
+        m_voiceManager.releaseAll();
     }
 
     static SoundFXController& getInstance();
 
   private:
+    static const int NUM_VOICES = 16;
+
     irrklang::ISoundEngine* m_engine;
+    std::vector<irrklang::ISoundSource*> m_sources;  // owned by m_engine
+    irrklang::ISound* m_playing[NUM_VOICES];         // tracked, so a voice can be cut
+    VoiceManager m_voiceManager;
+
+    void releaseVoice(int v, bool stop)
+    {
+        if (m_playing[v] == nullptr)
+            return;
+        if (stop)
+            m_playing[v]->stop();
+        m_playing[v]->drop();
+        m_playing[v] = nullptr;
+    }
 
     SoundFXController()
+     : m_playing(), m_voiceManager(NUM_VOICES)
     {
         m_engine = irrklang::createIrrKlangDevice();
         if (m_engine == nullptr)
@@ -41,7 +107,11 @@ class SoundFXController
     ~SoundFXController()
     {
         if (m_engine != nullptr)
+        {
+            for (int v = 0; v < NUM_VOICES; v++)
+                releaseVoice(v, false);
             m_engine->drop();
+        }
     }
 
     SoundFXController(const SoundFXController&);
@@ -50,33 +120,55 @@ class SoundFXController
 
 #elif defined(__APPLE__)
 
-#include <memory>
 #include <spawn.h>
+#include <sys/wait.h>
 #include <csignal>
-#include <cstring>
 
 class SoundFXController
 {
   public:
     SoundFXController()
-     : pidValid(false)
+     : pidValid(false), m_voiceManager(1)
     {}
 
-    void playClip(std::string soundFile)
+      // afplay can only play files, so keep a ready-made argument vector
+      // for each clip's path instead of the samples.
+    void registerClip(int soundID, const PcmClip& clip)
+    {
+        if (soundID < 0)
+            return;
+        if (soundID >= static_cast<int>(m_paths.size()))
+            m_paths.resize(soundID + 1);
+        m_paths[soundID].assign(clip.path.begin(), clip.path.end());
+        m_paths[soundID].push_back('\0');
+        m_voiceManager.setDuration(soundID, clip.durationMs());
+    }
+
+    void setPolicy(int soundID, const VoicePolicy& policy)
     {
-        char cmd[] = "/usr/bin/afplay";
-        std::unique_ptr<char[]> fileName(new char[soundFile.size()+1]);
-        std::strcpy(fileName.get(), soundFile.c_str());
-        char* argv[] = { cmd, fileName.get(), nullptr };
-        abortClip();  // stop anything currently playing
+        m_voiceManager.setPolicy(soundID, policy);
+    }
+
+      // There is only one afplay process at a time, so a sound interrupts
+      // the one playing only if it matters at least as much; otherwise it
+      // is dropped.
+    void playClip(int soundID)
+    {
+        if (soundID < 0  ||  soundID >= static_cast<int>(m_paths.size())  ||  m_paths[soundID].empty())
+            return;
+        bool stolen;
+        if (m_voiceManager.acquire(soundID, soundClockMs(), stolen) == VoiceManager::NO_VOICE)
+            return;
+        static char cmd[] = "/usr/bin/afplay";
+        char* argv[] = { cmd, m_paths[soundID].data(), nullptr };
+        stopProcess();
         pidValid = (posix_spawn(&pid, argv[0], nullptr, nullptr, argv, nullptr) == 0);
     }
-    
+
     void abortClip()
     {
-        if (pidValid)
-            kill(pid, SIGINT);
-        pidValid = false;
+        stopProcess();
+        m_voiceManager.releaseAll();
     }
     
     static SoundFXController& getInstance();
@@ -84,16 +176,75 @@ class SoundFXController
   private:
     pid_t pid;
     bool pidValid;
+    std::vector<std::vector<char>> m_paths;
+    VoiceManager m_voiceManager;
+
+      // Interrupt the current afplay, if it's still going, and reap it.
+    void stopProcess()
+    {
+        if (!pidValid)
+            return;
+        kill(pid, SIGINT);
+        waitpid(pid, nullptr, 0);
+        pidValid = false;
+    }
 };
 
-#else  // forget about sound
+#else  // software mixer, silent unless given a sink
+
+#include "AudioMixer.h"
+#include <memory>
+#include <ostream>
+
+#define SOUNDFX_SOFTWARE_MIXER 1
 
 class SoundFXController
 {
   public:
-    void playClip(std::string) {}
-    void abortClip() {}
+    void registerClip(int soundID, const PcmClip& clip)
+    {
+        m_mixer.registerClip(soundID, clip);
+    }
+
+    void setPolicy(int soundID, const VoicePolicy& policy)
+    {
+        m_mixer.setPolicy(soundID, policy);
+    }
+
+    void playClip(int soundID)
+    {
+        m_mixer.play(soundID);
+    }
+
+    void abortClip()
+    {
+        m_mixer.stopAll();
+    }
+
+      // "null" mixes and discards in real time; "wav:FILE" records to FILE.
+      // Call after every clip is registered.
+    bool startMixer(const std::string& sinkSpec)
+    {
+        std::unique_ptr<AudioSink> sink;
+        if (sinkSpec == "null")
+            sink.reset(new NullAudioSink);
+        else if (sinkSpec.compare(0, 4, "wav:") == 0)
+            sink.reset(new WavFileAudioSink(sinkSpec.substr(4), AudioMixer::SAMPLE_RATE));
+        return sink != nullptr  &&  m_mixer.start(std::move(sink));
+    }
+
+    void stopMixer(std::ostream* statsOut)
+    {
+        bool wasRunning = m_mixer.isRunning();
+        m_mixer.stop();
+        if (wasRunning  &&  statsOut != nullptr)
+            m_mixer.printStats(*statsOut);
+    }
+
     static SoundFXController& getInstance();
+
+  private:
+    AudioMixer m_mixer;
 };
 
 #endif
@@ -0,0 +1,141 @@
+#ifndef SPRITECELL_H_
+#define SPRITECELL_H_
+
+#include "TgaImage.h"
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPRITE_CELL_SSE2 1
+#endif
+
+  // A sprite frame as it sits in the sprite atlas: surrounded by PADDING
+  // texels copied from its own edges, and rounded up to a multiple of
+  // PADDING, which is 2 to the MAX_LEVEL.  Since every cell also starts on
+  // a multiple of PADDING, box filtering the atlas down to MAX_LEVEL never
+  // mixes two cells, and each atlas level is just its cells' levels put
+  // side by side.  That lets the reduced levels be computed once, offline,
+  // and stored with the frame in the asset bundle.
+
+struct SpriteCell
+{
+    static const int PADDING = 8;
+    static const int MAX_LEVEL = 3;     // 8 texels of padding become 1
+
+    unsigned int               width = 0;      // of level 0
+    unsigned int               height = 0;
+    std::vector<unsigned char> pixels;         // level 0, BGRA
+    std::vector<unsigned char> mips;           // levels 1 to MAX_LEVEL, one after another
+
+    static unsigned int cellSize(unsigned int size)
+    {
+        return (size + 2 * PADDING + PADDING - 1) / PADDING * PADDING;
+    }
+
+      // where level (1 to MAX_LEVEL) starts in mips, and the size of them all
+    static size_t mipOffset(unsigned int width, unsigned int height, int level)
+    {
+        size_t offset = 0;
+        for (int l = 1; l < level; l++)
+            offset += static_cast<size_t>(width >> l) * (height >> l) * 4;
+        return offset;
+    }
+
+    static size_t mipBytes(unsigned int width, unsigned int height)
+    {
+        return mipOffset(width, height, MAX_LEVEL + 1);
+    }
+
+    void build(const ImageView& image)
+    {
+        buildLevel0(image);
+        buildMips();
+    }
+
+    void buildLevel0(const ImageView& image)
+    {
+        width = cellSize(image.width);
+        height = cellSize(image.height);
+        pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+        writeLevel0(image, pixels.data(), width);
+    }
+
+    void buildMips()
+    {
+        mips.resize(mipBytes(width, height));
+        const unsigned char* source = pixels.data();
+        for (int level = 1; level <= MAX_LEVEL; level++)
+        {
+            unsigned char* target = &mips[mipOffset(width, height, level)];
+            reduce(source, width >> (level - 1), height >> (level - 1), target);
+            source = target;
+        }
+    }
+
+      // The frame and its gutter at the top left of a cell-sized region of
+      // dest, whose rows are destWidth texels apart.
+    static void writeLevel0(const ImageView& image, unsigned char* dest, size_t destWidth)
+    {
+        int w = image.width, h = image.height;
+        for (int y = -PADDING; y < h + PADDING; y++)
+        {
+            int sy = std::min(std::max(y, 0), h - 1);
+            const unsigned char* src = image.bgra + static_cast<size_t>(sy) * w * 4;
+            unsigned char* row = dest + ((y + PADDING) * destWidth + PADDING) * 4;
+            for (int x = -PADDING; x < 0; x++)
+                std::copy_n(src, 4, row + x * 4);
+            std::copy_n(src, static_cast<size_t>(w) * 4, row);
+            for (int x = w; x < w + PADDING; x++)
+                std::copy_n(src + (w - 1) * 4, 4, row + x * 4);
+        }
+    }
+
+      // 2x2 box filter of BGRA texels; width and height must be even.
+    static void reduce(const unsigned char* source, unsigned int width, unsigned int height, unsigned char* dest)
+    {
+        unsigned int outWidth = width / 2, outHeight = height / 2;
+        for (unsigned int y = 0; y < outHeight; y++)
+        {
+            const unsigned char* r0 = source + static_cast<size_t>(2 * y) * width * 4;
+            const unsigned char* r1 = r0 + static_cast<size_t>(width) * 4;
+            unsigned char* out = dest + static_cast<size_t>(y) * outWidth * 4;
+            unsigned int x = 0;
+#ifdef SPRITE_CELL_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i two = _mm_set1_epi16(2);
+            auto pairSums = [zero](__m128i top, __m128i bottom, __m128i& low, __m128i& high)
+            {
+                  // two texels per half, each summed over both rows and then
+                  // with its horizontal neighbour
+                __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+                __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+                low = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+                high = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+            };
+            for (; x + 4 <= outWidth; x += 4)
+            {
+                __m128i l0, h0, l1, h1;
+                pairSums(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + 8 * x)),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + 8 * x)), l0, h0);
+                pairSums(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + 8 * x + 16)),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + 8 * x + 16)), l1, h1);
+                __m128i a = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(l0, h0), two), 2);
+                __m128i b = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(l1, h1), two), 2);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * x), _mm_packus_epi16(a, b));
+            }
+#endif
+            for (; x < outWidth; x++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    out[4 * x + c] = static_cast<unsigned char>(
+                        (r0[8 * x + c] + r0[8 * x + 4 + c] + r1[8 * x + c] + r1[8 * x + 4 + c] + 2) >> 2);
+                }
+            }
+        }
+    }
+};
+
+#endif // SPRITECELL_H_
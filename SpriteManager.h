@@ -11,13 +11,24 @@
 #define GL_BGRA GL_BGRA_EXT
 #endif
 
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
 #include "GameConstants.h"
+#include "TgaImage.h"
+#include "SpriteCell.h"
 #include <iostream>
-#include <fstream>
 #include <string>
-#include <map>
-#include <memory>
+#include <vector>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <chrono>
 
 static const double VISIBLE_MIN_X = -2.39;
 static const double VISIBLE_MAX_X = 2.1; // 2.39;
@@ -31,7 +42,9 @@ class SpriteManager
 public:
 
     SpriteManager()
-     : m_mipMapped(true)
+     : m_nextUpload(0), m_atlasTexture(0), m_mipMapped(true),
+       m_staticTexture(0), m_staticTextureWidth(0), m_staticTextureHeight(0),
+       m_staticViewport(), m_staticVersion(0)
     {
     }
 
@@ -39,135 +52,229 @@ public:
     {
           // Load Texture Data From TGA File
 
+        TgaImage pixels;
+        if (!pixels.load(filename_tga))
+            return false;
+        return addSprite(std::move(pixels), imageID, frameNum);
+    }
+
+      // Take a frame already decoded, perhaps on another thread.  Nothing
+      // touches OpenGL until buildAtlas.
+    bool addSprite(TgaImage pixels, int imageID, int frameNum)
+    {
         int spriteID = getSpriteID(imageID, frameNum);
-        if (spriteID == INVALID_SPRITE_ID)
+        if (spriteID == INVALID_SPRITE_ID  ||  pixels.empty())
             return false;
 
-        m_frameCountPerSprite[imageID]++;   // keep track of how many frames per sprite we loaded
+          // Keep the pixels until buildAtlas packs them all.
+        PendingImage image;
+        image.spriteID = spriteID;
+        image.pixels = pixels.view();
+        image.owned = std::move(pixels);    // moving keeps the buffer the view points at
+        m_pending.push_back(std::move(image));
 
-        std::ifstream tgaFile(filename_tga, std::ios::in|std::ios::binary);
-        if (!tgaFile)
-            return false;
+        return true;
+    }
 
-        char type[3];
-        char info[6];
-
-          // Read file header info
-        tgaFile.read(type, 3);
-        tgaFile.seekg(12);
-        tgaFile.read(info, 6);
-        unsigned int textureWidth = static_cast<unsigned char>(info[0]) + static_cast<unsigned char>(info[1]) * 256;
-        unsigned int textureHeight = static_cast<unsigned char>(info[2]) + static_cast<unsigned char>(info[3]) * 256;
-        unsigned char byteCount = static_cast<unsigned char>(info[4]) / 8;
-        long imageSize = textureWidth * textureHeight * byteCount;
-        std::unique_ptr<char[]> imageData(new char[imageSize]);
-        tgaFile.seekg(18);
-          // Read image data
-        tgaFile.read(imageData.get(), imageSize);
-        if (!tgaFile)
+      // As above, but the pixels stay where they are (in a mapped asset
+      // bundle, say) and must outlive the call to buildAtlas.
+    bool addSprite(const ImageView& pixels, int imageID, int frameNum)
+    {
+        int spriteID = getSpriteID(imageID, frameNum);
+        if (spriteID == INVALID_SPRITE_ID  ||  pixels.empty())
             return false;
 
-          //image type either 2 (color) or 3 (greyscale)
-        if (type[1] != 0 || (type[2] != 2 && type[2] != 3))
-            return false;
+        PendingImage image;
+        image.spriteID = spriteID;
+        image.pixels = pixels;
+        m_pending.push_back(std::move(image));
 
-        if (byteCount != 3 && byteCount != 4)
+        return true;
+    }
+
+      // Pack every loaded frame into a single texture, and build the tables
+      // that map an image ID and frame to its place there.  Call once, after
+      // the last loadSprite.
+    bool buildAtlas()
+    {
+        return beginAtlas()  &&  uploadAtlas(-1);
+    }
+
+      // buildAtlas in steps: lay the frames out and make the texture, then
+      // fill it a few frames at a time, so that loading can share the GL
+      // thread with drawing.  A frame is drawn only once it is uploaded.
+      //
+      // Each frame is laid out as a SpriteCell: surrounded by a gutter
+      // copied from its own edges and starting on a multiple of the gutter
+      // width, with the mip chain stopping where that gutter shrinks to one
+      // texel, so filtering never blends in a neighbouring frame.  A frame's
+      // reduced levels come precomputed from the asset bundle when it has
+      // them; otherwise they are box filtered here.  Either way every level
+      // is uploaded as it is, with nothing resampled by OpenGL or GLU.
+    bool beginAtlas()
+    {
+        if (m_pending.empty())
             return false;
 
+          // shelf packing, tallest frames first
+        std::vector<PendingImage*> order;
+        for (PendingImage& image : m_pending)
+            order.push_back(&image);
+        std::stable_sort(order.begin(), order.end(),
+            [](const PendingImage* a, const PendingImage* b) { return a->pixels.height > b->pixels.height; });
+
+        unsigned int atlasWidth = ATLAS_WIDTH;
+        for (const PendingImage* image : order)
+        {
+            while (cellSize(image->pixels.width) > atlasWidth)
+                atlasWidth *= 2;
+        }
+        unsigned int shelfX = 0, shelfY = 0, shelfHeight = 0;
+        for (PendingImage* image : order)
+        {
+            if (shelfX + cellSize(image->pixels.width) > atlasWidth)
+            {
+                shelfY += shelfHeight;
+                shelfX = shelfHeight = 0;
+            }
+            image->cellX = shelfX;
+            image->cellY = shelfY;
+            shelfX += cellSize(image->pixels.width);
+            shelfHeight = std::max(shelfHeight, cellSize(image->pixels.height));
+        }
+        unsigned int atlasHeight = 1;
+        while (atlasHeight < shelfY + shelfHeight)
+            atlasHeight *= 2;
+
+          // Flat lookup tables: an image's frames are contiguous in
+          // m_frames, starting at m_firstFrame[imageID].
+        int numImages = 0;
+        std::vector<int> framesPerImage;
+        for (const PendingImage& image : m_pending)
+            numImages = std::max(numImages, image.spriteID / MAX_FRAMES_PER_SPRITE + 1);
+        framesPerImage.assign(numImages, 0);
+        m_numFrames.assign(numImages, 0);
+        for (const PendingImage& image : m_pending)
+        {
+            int imageID = image.spriteID / MAX_FRAMES_PER_SPRITE;
+            int frame = image.spriteID % MAX_FRAMES_PER_SPRITE;
+            framesPerImage[imageID] = std::max(framesPerImage[imageID], frame + 1);
+            m_numFrames[imageID]++;
+        }
+        m_firstFrame.assign(numImages + 1, 0);
+        for (int imageID = 0; imageID < numImages; imageID++)
+            m_firstFrame[imageID + 1] = m_firstFrame[imageID] + framesPerImage[imageID];
+        m_frames.assign(m_firstFrame[numImages], SpriteRect());
+        for (const PendingImage& image : m_pending)
+        {
+            int imageID = image.spriteID / MAX_FRAMES_PER_SPRITE;
+            SpriteRect& rect = m_frames[m_firstFrame[imageID] + image.spriteID % MAX_FRAMES_PER_SPRITE];
+            rect.u0 = GLfloat(image.cellX + ATLAS_PADDING) / atlasWidth;
+            rect.v0 = GLfloat(image.cellY + ATLAS_PADDING) / atlasHeight;
+            rect.u1 = GLfloat(image.cellX + ATLAS_PADDING + image.pixels.width) / atlasWidth;
+            rect.v1 = GLfloat(image.cellY + ATLAS_PADDING + image.pixels.height) / atlasHeight;
+        }
+
           // Transfer Texture To OpenGL
 
         glEnable(GL_DEPTH_TEST);
 
-          // allocate a texture handle
-        GLuint glTextureID;
-        glGenTextures(1, &glTextureID);
-
-          // bind our new texture
-        glBindTexture(GL_TEXTURE_2D, glTextureID);
+        glGenTextures(1, &m_atlasTexture);
+        glBindTexture(GL_TEXTURE_2D, m_atlasTexture);
 
         glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
         if (m_mipMapped)
         {
               // when texture area is small, bilinear filter the closest mipmap
-            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-              // when texture area is large, bilinear filter the first mipmap
-            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ATLAS_MAX_MIP_LEVEL);
         }
         else
-        {
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-          // Have the texture wrap both vertically and horizontally.
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, static_cast<GLfloat>(GL_REPEAT));
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, static_cast<GLfloat>(GL_REPEAT));
+          // frames are padded, so clamping only matters at the atlas border
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-        if (m_mipMapped)
+          // clear, so that texels between cells are transparent
+        std::vector<unsigned char> blank(static_cast<size_t>(atlasWidth) * atlasHeight * 4, 0);
+        for (int level = 0; level <= (m_mipMapped ? ATLAS_MAX_MIP_LEVEL : 0); level++)
         {
-              // build our texture mipmaps
-              // byteCount of 3 means that BGR data is being supplied. byteCount of 4 means that BGRA data is being supplied.
-            makeMipmaps(byteCount, textureWidth, textureHeight, imageData.get());
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, atlasWidth >> level, atlasHeight >> level, 0,
+                         GL_BGRA, GL_UNSIGNED_BYTE, blank.data());
         }
-        else
+        m_nextUpload = 0;
+        return true;
+    }
+
+      // Upload frames, whole, until budgetMs has run out (all of them if it
+      // is negative), but always at least one.  True once every frame is in.
+    bool uploadAtlas(double budgetMs)
+    {
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point start = Clock::now();
+        glBindTexture(GL_TEXTURE_2D, m_atlasTexture);
+        for (bool first = true; m_nextUpload < m_pending.size(); first = false)
         {
-              // byteCount of 3 means that BGR data is being supplied. byteCount of 4 means that BGRA data is being supplied.
-            if (3 == byteCount)
-                glTexImage2D(GL_TEXTURE_2D, 0, 3, textureWidth, textureHeight, 0, GL_BGR, GL_UNSIGNED_BYTE, imageData.get());
-            else if (4 == byteCount)
-                glTexImage2D(GL_TEXTURE_2D, 0, 4, textureWidth, textureHeight, 0, GL_BGRA, GL_UNSIGNED_BYTE, imageData.get());
+            if (!first  &&  budgetMs >= 0  &&
+                std::chrono::duration<double, std::milli>(Clock::now() - start).count() >= budgetMs)
+                return false;
+            const PendingImage& image = m_pending[m_nextUpload++];
+            SpriteCell cell;
+            cell.buildLevel0(image.pixels);
+            const unsigned char* mips = image.pixels.mips;
+            if (m_mipMapped  &&  mips == nullptr)
+            {
+                cell.buildMips();
+                mips = cell.mips.data();
+            }
+            glTexSubImage2D(GL_TEXTURE_2D, 0, image.cellX, image.cellY, cell.width, cell.height,
+                            GL_BGRA, GL_UNSIGNED_BYTE, cell.pixels.data());
+            for (int level = 1; m_mipMapped  &&  level <= ATLAS_MAX_MIP_LEVEL; level++)
+            {
+                glTexSubImage2D(GL_TEXTURE_2D, level, image.cellX >> level, image.cellY >> level,
+                                cell.width >> level, cell.height >> level, GL_BGRA, GL_UNSIGNED_BYTE,
+                                mips + SpriteCell::mipOffset(cell.width, cell.height, level));
+            }
+            int imageID = image.spriteID / MAX_FRAMES_PER_SPRITE;
+            m_frames[m_firstFrame[imageID] + image.spriteID % MAX_FRAMES_PER_SPRITE].loaded = true;
         }
-
-        m_imageMap[spriteID] = glTextureID;
-
+        m_pending.clear();
+        m_nextUpload = 0;
         return true;
     }
 
+      // frames given to addSprite and not yet uploaded
+    int framesPending() const
+    {
+        return static_cast<int>(m_pending.size() - m_nextUpload);
+    }
+
     int getNumFrames(int imageID) const
     {
-        auto it = m_frameCountPerSprite.find(imageID);
-        if (it == m_frameCountPerSprite.end())
+        if (imageID < 0  ||  imageID >= static_cast<int>(m_numFrames.size()))
             return 0;
 
-        return it->second;
+        return m_numFrames[imageID];
     }
 
-    bool plotSprite(int imageID, int frame, double x, double y, int angleDegrees, double size)
+      // Queue a sprite for this frame; nothing is drawn until flushSprites.
+      // Sprites are drawn in the order queued, and all come from the atlas,
+      // so one flush is one bind and one draw call.  depth is accepted only
+      // so both renderers share an interface; queue order sets the layering.
+    bool plotSprite(int imageID, int frame, double x, double y, int angleDegrees, double size, int /* depth */ = 0)
     {
-        int spriteID = getSpriteID(imageID, frame);
-        if (spriteID == INVALID_SPRITE_ID)
+        const SpriteRect* rect = frameRect(imageID, frame);
+        if (rect == nullptr)
             return false;
 
-        auto it = m_imageMap.find(spriteID);
-        if (it == m_imageMap.end())
-            return false;
-
-        glPushMatrix();
-
         double finalWidth = SPRITE_WIDTH_GL * size;
         double finalHeight = SPRITE_HEIGHT_GL * size;
 
-        // object's x/y location is center-based, but sprite plotting is upper-left-corner based
-        const double xoffset = 0;// finalWidth / 2;
-        const double yoffset = 0;// finalHeight / 2;
-
         double gx, gy, gz;
         convertToGlutCoords(x, y, gx, gy, gz);
-        glTranslatef(static_cast<GLfloat>(gx-xoffset),static_cast<GLfloat>(gy-yoffset),static_cast<GLfloat>(gz));
-        glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glEnable(GL_TEXTURE_2D);
-        glDisable(GL_DEPTH_TEST);
-        glEnable (GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glBindTexture(GL_TEXTURE_2D, it->second);
-
-        glColor3f(1.0, 1.0, 1.0);
-
-        double cx1 = 0, cy1 = 0;
-        double cx2 = 1, cy2 = 0;
-        double cx3 = 1, cy3 = 1;
-        double cx4 = 0, cy4 = 1;
 
           // Rotate sprite.  For 180 degrees, don't rotate, but reflect
         double rx1, ry1, rx2, ry2, rx3, ry3, rx4, ry4;
@@ -183,24 +290,36 @@ public:
             std::swap(rx3, rx4);
         }
 
-        glBegin(GL_QUADS);
-        glTexCoord2d(cx1, cy1);
-        glVertex3f(static_cast<GLfloat>(rx1), static_cast<GLfloat>(ry1), 0);
-        glTexCoord2d(cx2, cy2);
-        glVertex3f(static_cast<GLfloat>(rx2), static_cast<GLfloat>(ry2), 0);
-        glTexCoord2d(cx3, cy3);
-        glVertex3f(static_cast<GLfloat>(rx3), static_cast<GLfloat>(ry3), 0);
-        glTexCoord2d(cx4, cy4);
-        glVertex3f(static_cast<GLfloat>(rx4), static_cast<GLfloat>(ry4), 0);
-        glEnd();
+        const SpriteRect& r = *rect;
+        m_vertices.push_back({ r.u0, r.v0, GLfloat(gx + rx1), GLfloat(gy + ry1), GLfloat(gz) });
+        m_vertices.push_back({ r.u1, r.v0, GLfloat(gx + rx2), GLfloat(gy + ry2), GLfloat(gz) });
+        m_vertices.push_back({ r.u1, r.v1, GLfloat(gx + rx3), GLfloat(gy + ry3), GLfloat(gz) });
+        m_vertices.push_back({ r.u0, r.v1, GLfloat(gx + rx4), GLfloat(gy + ry4), GLfloat(gz) });
 
-        glDisable(GL_TEXTURE_2D);
-        glEnable(GL_DEPTH_TEST);
+        return true;
+    }
+
+      // Draw everything queued since the last flush.
+    void flushSprites()
+    {
+        if (m_vertices.empty())
+            return;
 
+        glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT);
+        glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+        glEnable(GL_TEXTURE_2D);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glColor3f(1.0, 1.0, 1.0);
+        glInterleavedArrays(GL_T2F_V3F, 0, m_vertices.data());
+        glBindTexture(GL_TEXTURE_2D, m_atlasTexture);
+        glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(m_vertices.size()));
+
+        glPopClientAttrib();
         glPopAttrib();
-        glPopMatrix();
 
-        return true;
+        m_vertices.clear();
     }
 
     static void drawCircle(float cx, float cy, float r, int num_segments) {
@@ -217,21 +336,153 @@ public:
         glEnd();
 }
 
+      // The static layer is a copy of the screen taken right after the
+      // static objects were drawn onto a cleared frame.  Copying the back
+      // buffer into a texture needs nothing past OpenGL 1.1, unlike a
+      // framebuffer object, and costs the same since it happens only when
+      // the layer changes.
+
+      // Draw the cached layer over the whole viewport, if it is still good
+      // for this version of the static objects and this window size.
+    bool drawStaticLayer(uint64_t version)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        if (m_staticTexture == 0  ||  version != m_staticVersion  ||
+            !std::equal(viewport, viewport + 4, m_staticViewport))
+            return false;
+
+        glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, m_staticTexture);
+        glColor3f(1.0, 1.0, 1.0);
+        glMatrixMode(GL_PROJECTION);
+        glPushMatrix();
+        glLoadIdentity();
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glLoadIdentity();
+
+        GLfloat s = GLfloat(viewport[2]) / m_staticTextureWidth;
+        GLfloat t = GLfloat(viewport[3]) / m_staticTextureHeight;
+        glBegin(GL_QUADS);
+        glTexCoord2f(0, 0);
+        glVertex2f(-1, -1);
+        glTexCoord2f(s, 0);
+        glVertex2f( 1, -1);
+        glTexCoord2f(s, t);
+        glVertex2f( 1,  1);
+        glTexCoord2f(0, t);
+        glVertex2f(-1,  1);
+        glEnd();
+
+        glPopMatrix();
+        glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+        glMatrixMode(GL_MODELVIEW);
+        glPopAttrib();
+        return true;
+    }
+
+      // Keep what has been drawn so far this frame as the static layer.
+    void captureStaticLayer(uint64_t version)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        if (m_staticTexture == 0  ||  !std::equal(viewport, viewport + 4, m_staticViewport))
+        {
+            GLsizei width = 1, height = 1;
+            while (width < viewport[2])
+                width *= 2;
+            while (height < viewport[3])
+                height *= 2;
+            if (m_staticTexture == 0)
+                glGenTextures(1, &m_staticTexture);
+            glBindTexture(GL_TEXTURE_2D, m_staticTexture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+            m_staticTextureWidth = width;
+            m_staticTextureHeight = height;
+            std::copy(viewport, viewport + 4, m_staticViewport);
+        }
+        glBindTexture(GL_TEXTURE_2D, m_staticTexture);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], viewport[2], viewport[3]);
+        m_staticVersion = version;
+    }
+
     ~SpriteManager()
     {
-        for (auto it = m_imageMap.begin(); it != m_imageMap.end(); it++)
-            glDeleteTextures(1, &it->second);
+        if (m_atlasTexture != 0)
+            glDeleteTextures(1, &m_atlasTexture);
+        if (m_staticTexture != 0)
+            glDeleteTextures(1, &m_staticTexture);
     }
 
 private:
 
-    std::map<int, GLuint>   m_imageMap;
-    std::map<int, int>      m_frameCountPerSprite;
+      // where a frame lives in the atlas
+    struct SpriteRect
+    {
+        GLfloat u0 = 0, v0 = 0, u1 = 0, v1 = 0;
+        bool    loaded = false;
+    };
+
+      // a decoded frame waiting for buildAtlas
+    struct PendingImage
+    {
+        int          spriteID;
+        ImageView    pixels;
+        TgaImage     owned;     // empty when the pixels belong to someone else
+        unsigned int cellX = 0; // placed by beginAtlas
+        unsigned int cellY = 0;
+    };
+
+    std::vector<SpriteRect>   m_frames;        // every frame of every image
+    std::vector<int>          m_firstFrame;    // by image ID, index into m_frames; one extra at the end
+    std::vector<int>          m_numFrames;     // by image ID
+    std::vector<PendingImage> m_pending;
+    size_t                    m_nextUpload;    // into m_pending
+    GLuint                    m_atlasTexture;
     bool                    m_mipMapped;
 
+      // layout matches GL_T2F_V3F
+    struct BatchVertex
+    {
+        GLfloat u, v;
+        GLfloat x, y, z;
+    };
+
+    std::vector<BatchVertex>   m_vertices;     // four per queued sprite
+
+    GLuint                     m_staticTexture;
+    GLsizei                    m_staticTextureWidth;
+    GLsizei                    m_staticTextureHeight;
+    GLint                      m_staticViewport[4];
+    uint64_t                   m_staticVersion;
+
     static const int INVALID_SPRITE_ID = -1;
     static const int MAX_IMAGES = 1000;
     static const int MAX_FRAMES_PER_SPRITE = 100;
+    static const unsigned int ATLAS_WIDTH = 1024;
+    static const int ATLAS_PADDING = SpriteCell::PADDING;
+    static const int ATLAS_MAX_MIP_LEVEL = SpriteCell::MAX_LEVEL;
+
+    static unsigned int cellSize(unsigned int size)
+    {
+        return SpriteCell::cellSize(size);
+    }
+
+    const SpriteRect* frameRect(int imageID, int frame) const
+    {
+        if (imageID < 0  ||  imageID >= static_cast<int>(m_numFrames.size())  ||
+            frame < 0  ||  frame >= m_firstFrame[imageID + 1] - m_firstFrame[imageID])
+            return nullptr;
+        const SpriteRect& rect = m_frames[m_firstFrame[imageID] + frame];
+        return rect.loaded ? &rect : nullptr;
+    }
 
     static int getSpriteID(int imageID, int frame)
     {
@@ -257,18 +508,6 @@ private:
         gy = 2 * VISIBLE_MIN_Y +      y * 2 * (VISIBLE_MAX_Y - VISIBLE_MIN_Y);
         gz = .6 * VISIBLE_MIN_Z;
     }
-
-    static void makeMipmaps(unsigned char byteCount, unsigned int textureWidth, unsigned int textureHeight, char* imageData)
-    {
-        int format = (byteCount == 3 ? GL_BGR : GL_BGRA);
-#ifdef __APPLE__
-        int internalFormat = (byteCount == 3 ? GL_RGB : GL_RGBA);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, textureWidth, textureHeight, 0, format, GL_UNSIGNED_BYTE, imageData);
-        glGenerateMipmap(GL_TEXTURE_2D);
-#else
-        gluBuild2DMipmaps(GL_TEXTURE_2D, byteCount, textureWidth, textureHeight, format, GL_UNSIGNED_BYTE, imageData);
-#endif
-    }
 };
 
 #endif // SPRITEMANAGER_H_
@@ -0,0 +1,69 @@
+#ifndef SPSCRING_H_
+#define SPSCRING_H_
+
+#include <atomic>
+#include <cstddef>
+
+  // Bounded lock-free queue for exactly one producer thread and one consumer
+  // thread.  Capacity must be a power of two.  push fails instead of waiting
+  // when the ring is full, so the producer never blocks.
+
+template<typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity >= 2  &&  (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+  public:
+    SpscRing()
+     : m_head(0), m_tail(0)
+    {
+    }
+
+      // Producer side
+    bool push(const T& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        m_items[tail & (Capacity - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+      // Consumer side
+    bool pop(T& item)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        item = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+      // Consumer side: look at the oldest item without removing it.
+    bool peek(T& item) const
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        item = m_items[head & (Capacity - 1)];
+        return true;
+    }
+
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+  private:
+    T                   m_items[Capacity];
+    std::atomic<size_t> m_head;     // next item to pop, written by the consumer
+    std::atomic<size_t> m_tail;     // next slot to fill, written by the producer
+};
+
+#endif // SPSCRING_H_
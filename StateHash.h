@@ -0,0 +1,68 @@
+#ifndef STATEHASH_H_
+#define STATEHASH_H_
+
+#include <cstdint>
+#include <cstring>
+
+  // Incrementally maintained hash of the simulation state.  Every hashed
+  // object owns a 64-bit contribution and the aggregate is the XOR of all
+  // of them, so a mutation costs one XOR out of the old contribution and
+  // one XOR in of the new one, and removing an object just XORs it out.
+
+class StateHash
+{
+  public:
+    StateHash()
+     : m_value(0)
+    {}
+
+    uint64_t value() const
+    {
+        return m_value;
+    }
+
+    void replace(uint64_t oldContribution, uint64_t newContribution)
+    {
+        m_value ^= oldContribution ^ newContribution;
+    }
+
+    void reset()
+    {
+        m_value = 0;
+    }
+
+      // splitmix64 finalizer applied to the running hash combined with v
+    static uint64_t mix(uint64_t h, uint64_t v)
+    {
+        uint64_t z = h + 0x9e3779b97f4a7c15ULL + v;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    static uint64_t mix(uint64_t h, int v)
+    {
+        return mix(h, static_cast<uint64_t>(static_cast<int64_t>(v)));
+    }
+
+      // Hashes the exact bit pattern, so any floating point drift shows up.
+    static uint64_t mix(uint64_t h, double v)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return mix(h, bits);
+    }
+
+  private:
+    uint64_t m_value;
+};
+
+  // One hashed object's contribution, used to locate a divergence.
+struct ActorDigest
+{
+    uint32_t serial;
+    int32_t  imageID;
+    uint64_t digest;
+};
+
+#endif // STATEHASH_H_
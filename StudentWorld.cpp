@@ -1,12 +1,14 @@
 #include "StudentWorld.h"
 #include "GameConstants.h"
 #include "Actor.h"
+#include "TickProfiler.h"
+#include "ActorAccounting.h"
 #include <string>
 #include <algorithm>
 #include <cmath>
 #include <iostream>
-#include <iomanip>
-#include <sstream>
+#include <iterator>
+#include <cstdio>
 using namespace std;
 
 GameWorld* createStudentWorld(string assetPath)
@@ -19,12 +21,16 @@ StudentWorld::StudentWorld(string assetPath)
 {
     m_numPits = 0;
     m_numBacteria = 0;
+    m_player = nullptr;
+    m_nextSerial = 0;
+    m_statsShown = false;
 }
 
 int StudentWorld::init()
 {
     //add socrates
     m_player = new Socrates(0, VIEW_HEIGHT/2, this);
+    m_statsShown = false;
 
     //add pit objects
     double startX, startY;
@@ -92,10 +98,45 @@ int StudentWorld::init()
 
 int StudentWorld::move()
 {
+    TRACE_SCOPE("world", "StudentWorld::move");
+    PROFILE_TICK_BEGIN();
+    m_events.clear();
+    int status = tick();
+    PROFILE_PHASE(events);
+    applyTickEvents();
+    PROFILE_PHASE(hud);
+    updateGameStatText();
+    PROFILE_TICK_END();
+#ifdef KONTAGION_PROFILE
+    ACCOUNT_ALIVE(m_player);
+    for (Actor* actor : m_actors)
+    {
+        if (actor->alive())
+            ACCOUNT_ALIVE(actor);
+    }
+    ACCOUNT_TICK_END(getLevel());
+    if (status != GWSTATUS_CONTINUE_GAME)
+    {
+        const char* outcome = (status == GWSTATUS_FINISHED_LEVEL ? "finished" : "life lost");
+        PROFILE_LEVEL_END(cout, getLevel(), outcome);
+        ACCOUNT_LEVEL_END(cout, getLevel(), outcome);
+    }
+#endif
+    return status;
+}
+
+int StudentWorld::tick()
+{
+    PROFILE_PHASE(player);
+    ACCOUNT_UPDATES_BEGIN();
     m_player->doSomething();
+    ACCOUNT_UPDATED(m_player);
+    PROFILE_PHASE(actors);
+    ACCOUNT_UPDATES_BEGIN();
     for (list<Actor* >::iterator it = m_actors.begin(); it != m_actors.end(); it++)
     {
         (*it)->doSomething();
+        ACCOUNT_UPDATED(*it);
 
         //check if Socrates is still alive
         if (!m_player->alive())
@@ -107,12 +148,13 @@ int StudentWorld::move()
         //check if level is completed
         if (m_numPits == 0 && m_numBacteria == 0)
         {
-            playSound(SOUND_FINISHED_LEVEL);
+            queueSound(SOUND_FINISHED_LEVEL);
             return GWSTATUS_FINISHED_LEVEL;
         }
     }
 
     //delete actors that are no longer alive at the end of the round
+    PROFILE_PHASE(reap);
     for (list<Actor* >::iterator it = m_actors.begin(); it != m_actors.end();)
     {
         if (!(*it)->alive())
@@ -125,6 +167,7 @@ int StudentWorld::move()
     }
 
     //add fungus
+    PROFILE_PHASE(spawn);
     int chanceFungus = max(510 - getLevel() * 10, 200);
     int probFungus = randInt(0, chanceFungus - 1);
     if (probFungus == 0)
@@ -161,44 +204,111 @@ int StudentWorld::move()
         }
     }
 
-    //add actors that are on the stack
-    while (!m_actorsToAdd.empty())
+    return GWSTATUS_CONTINUE_GAME;
+}
+
+void StudentWorld::applyTickEvents()
+{
+    unsigned int soundsPlayed = 0;  //one bit per sound ID
+    int scoreDelta = 0;
+    int livesDelta = 0;
+    bool scored = false;
+    for (const TickEvent& e : m_events.events())
+    {
+        switch (e.type)
+        {
+        case TickEvent::sound:
+            if (e.value >= 0 && e.value < 32)
+            {
+                if (soundsPlayed & (1u << e.value))
+                    break;  //already played this tick
+                soundsPlayed |= 1u << e.value;
+            }
+            playSound(e.value);
+            m_events.noteApplied(TickEvent::sound);
+            break;
+        case TickEvent::score:
+            scoreDelta += e.value;
+            scored = true;
+            break;
+        case TickEvent::lives:
+            livesDelta += e.value;
+            break;
+        default:
+            break;
+        }
+    }
+    if (scored)
+    {
+        increaseScore(scoreDelta);
+        m_events.noteApplied(TickEvent::score);
+    }
+    if (livesDelta > 0)
+    {
+        for (int i = 0; i < livesDelta; i++)
+            incLives();
+        m_events.noteApplied(TickEvent::lives);
+    }
+
+    //add actors spawned during the tick, newest first, as when they were kept on a stack
+    if (!m_actorsToAdd.empty())
     {
-        m_actors.push_back(m_actorsToAdd.top());
-        m_actorsToAdd.pop();
+        m_actors.insert(m_actors.end(), m_actorsToAdd.rbegin(), m_actorsToAdd.rend());
+        m_actorsToAdd.clear();
+        m_events.noteApplied(TickEvent::spawn);
     }
+    m_events.endTick();
+}
 
-    //update GameStatText
-    ostringstream gameText;
-    gameText << "Score: ";
-    gameText.fill('0');
-    if (getScore() < 0)
-        gameText << '-' << setw(5) << abs(getScore());
-    else
-        gameText << setw(6) << getScore();
-    gameText.fill(' ');
-    gameText << "  Level: ";
-    gameText << setw(2) << getLevel();
-    gameText << "  Lives: ";
-    gameText << setw(1) << getLives();
-    gameText << "  Health: ";
-    gameText << setw(3) << m_player->health();
-    gameText << "  Sprays: ";
-    gameText << setw(2) << m_player->numSpray();
-    gameText << "  Flames: ";
-    gameText << setw(2) << m_player->numFlame();
-    setGameStatText(gameText.str());
-    return GWSTATUS_CONTINUE_GAME;
+void StudentWorld::updateGameStatText()
+{
+    int stats[6] = { getScore(), getLevel(), getLives(),
+                     m_player->health(), m_player->numSpray(), m_player->numFlame() };
+    if (m_statsShown && equal(begin(stats), end(stats), m_shownStats))
+        return;
+    copy(begin(stats), end(stats), m_shownStats);
+    m_statsShown = true;
+
+    char gameText[128];
+    snprintf(gameText, sizeof(gameText),
+             stats[0] < 0 ? "Score: -%05d  Level: %2d  Lives: %1d  Health: %3d  Sprays: %2d  Flames: %2d"
+                          : "Score: %06d  Level: %2d  Lives: %1d  Health: %3d  Sprays: %2d  Flames: %2d",
+             abs(stats[0]), stats[1], stats[2], stats[3], stats[4], stats[5]);
+    setGameStatText(gameText);
 }
 
 void StudentWorld::cleanUp()
 {
     delete m_player;
+    m_player = nullptr;
     for (list<Actor* >::iterator it = m_actors.begin(); it != m_actors.end();)
     {
         delete *it;
         it = m_actors.erase(it);
     }
+    //actors spawned during a tick that ended early never reached m_actors;
+    //without this they would turn up in the next level
+    for (Actor* actor : m_actorsToAdd)
+        delete actor;
+    m_actorsToAdd.clear();
+}
+
+uint64_t StudentWorld::stateHash() const
+{
+    uint64_t h = StateHash::mix(m_stateHash.value(), getScore());
+    h = StateHash::mix(h, getLives());
+    h = StateHash::mix(h, getLevel());
+    h = StateHash::mix(h, m_numBacteria);
+    return StateHash::mix(h, m_numPits);
+}
+
+void StudentWorld::stateDigests(vector<ActorDigest>& digests) const
+{
+    digests.clear();
+    if (m_player != nullptr)
+        digests.push_back({ m_player->serial(), m_player->getImageID(), m_player->digest() });
+    for (list<Actor* >::const_iterator it = m_actors.begin(); it != m_actors.end(); it++)
+        digests.push_back({ (*it)->serial(), (*it)->getImageID(), (*it)->digest() });
 }
 
 double StudentWorld::dist(double x1, double y1, double x2, double y2) const
@@ -222,6 +332,7 @@ bool StudentWorld::overlapWithPlayer(Actor* actor) const
 
 bool StudentWorld::moveOverlap(Bacteria* bacteria, int step)
 {
+    ACCOUNT_QUERY(moveOverlap, bacteria);
     const double PI = 4 * atan(1);
     //compute the bacteria's xy coordinates after moving
     double newX = bacteria->getX() + step * cos(PI * bacteria->getDirection() / 180);
@@ -242,6 +353,7 @@ bool StudentWorld::moveOverlap(Bacteria* bacteria, int step)
 
 bool StudentWorld::dealDamage(Projectile* projectile)
 {   
+    ACCOUNT_QUERY(dealDamage, projectile);
     for (list<Actor* >::iterator it = m_actors.begin(); it != m_actors.end(); it++)
     {
         if ((*it)->alive() && (*it)->damageable() && overlap(projectile, (*it)->getMe()))
@@ -259,6 +371,7 @@ double StudentWorld::distToPlayer(Actor* actor)
 
 bool StudentWorld::eatFood(Bacteria* bacteria)
 {   
+    ACCOUNT_QUERY(eatFood, bacteria);
     for (list<Actor* >::iterator it = m_actors.begin(); it != m_actors.end(); it++)
     {
         if ((*it)->alive() && (*it)->edible() && overlap(bacteria, (*it)->getMe()))
@@ -287,6 +400,7 @@ int StudentWorld::getPlayerDirection(Actor* actor)
 
 bool StudentWorld::findClosestFood(Salmonella* salmon)
 {
+    ACCOUNT_QUERY(findClosestFood, salmon);
     const double PI = 4 * atan(1);
     Actor* food = nullptr;
     double minDist = VIEW_RADIUS;   //any further the Salmonella can't detect the food
@@ -310,12 +424,33 @@ bool StudentWorld::addActor(Actor* actor)
 {
     if (actor != nullptr)
     {
-        m_actorsToAdd.push(actor); 
+        m_actorsToAdd.push_back(actor);
+        m_events.record(TickEvent::spawn, actor->getImageID());
         return true;
     }
     return false;
 }
 
+void StudentWorld::queueSound(int soundID)
+{
+    m_events.record(TickEvent::sound, soundID);
+}
+
+void StudentWorld::queueScore(int howMuch)
+{
+    m_events.record(TickEvent::score, howMuch);
+}
+
+void StudentWorld::queueExtraLife()
+{
+    m_events.record(TickEvent::lives, 1);
+}
+
+const TickEventBuffer* StudentWorld::tickEvents() const
+{
+    return &m_events;
+}
+
 bool StudentWorld::decBacteria()
 {
     if (m_numBacteria > 0)
@@ -2,9 +2,11 @@
 #define STUDENTWORLD_H_
 
 #include "GameWorld.h"
+#include "StateHash.h"
+#include "TickEvents.h"
 #include <string>
 #include <list>
-#include <stack>
+#include <vector>
 
 class Actor;
 class Socrates;
@@ -56,7 +58,19 @@ public:
     //in degrees
 
     bool addActor(Actor* actor);
-    //return whether actor is successfully added
+    //return whether actor is successfully added at the end of the tick
+
+    void queueSound(int soundID);
+    //play a sound at the end of the tick, at most once per tick per sound
+
+    void queueScore(int howMuch);
+    //add to the score at the end of the tick
+
+    void queueExtraLife();
+    //add a life at the end of the tick
+
+    virtual const TickEventBuffer* tickEvents() const;
+    //return the side effects requested during the last tick
 
     void incBacteria();
     //increment numBacteria by 1
@@ -67,6 +81,18 @@ public:
     bool decPits();
     //decrement numPit by 1
 
+    uint32_t nextActorSerial();
+    //return a serial number for a newly created actor
+
+    void updateStateHash(uint64_t oldDigest, uint64_t newDigest);
+    //swap an actor's old contribution to the state hash for its new one
+
+    virtual uint64_t stateHash() const;
+    //return the hash of all actors combined with the game counters
+
+    virtual void stateDigests(std::vector<ActorDigest>& digests) const;
+    //return the contribution of each actor, in update order
+
     virtual ~StudentWorld();
 
 private:
@@ -74,7 +100,22 @@ private:
     int m_numBacteria;
     Socrates* m_player;
     std::list<Actor* > m_actors;
-    std::stack<Actor* > m_actorsToAdd;
+    std::vector<Actor* > m_actorsToAdd;
+    TickEventBuffer m_events;
+    StateHash m_stateHash;
+    uint32_t m_nextSerial;
+    int m_shownStats[6];
+    bool m_statsShown;
+    //the values the status line was last built from
+
+    int tick();
+    //update every actor; side effects are recorded in m_events
+
+    void applyTickEvents();
+    //coalesce and apply the side effects recorded during the tick
+
+    void updateGameStatText();
+    //rebuild the status line, only if something on it changed
 
     void initXY(double& x, double& y) const;    //for init purposes
 
@@ -88,4 +129,14 @@ inline void StudentWorld::incBacteria()
     m_numBacteria++;
 }
 
+inline uint32_t StudentWorld::nextActorSerial()
+{
+    return m_nextSerial++;
+}
+
+inline void StudentWorld::updateStateHash(uint64_t oldDigest, uint64_t newDigest)
+{
+    m_stateHash.replace(oldDigest, newDigest);
+}
+
 #endif // STUDENTWORLD_H_
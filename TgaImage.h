@@ -0,0 +1,224 @@
+#ifndef TGAIMAGE_H_
+#define TGAIMAGE_H_
+
+#include "Tracer.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+  // A sprite image decoded from a TGA file, as BGRA with the bottom row
+  // first, which is how the framework's files are stored and what OpenGL
+  // expects.  Uncompressed and run-length encoded true color (types 2 and
+  // 10, 24 or 32 bits) and greyscale (types 3 and 11, 8 bits, or 24 and
+  // 32 bits read as true color) are understood.  Every length is checked
+  // against the data actually there, so a truncated or corrupt file is
+  // rejected rather than over-read.  Decoding touches no graphics API, so
+  // it serves every renderer and can run on any thread.
+
+  // Decoded pixels owned by someone else: a TgaImage, or an asset bundle
+  // mapped into memory.
+
+struct ImageView
+{
+    unsigned int         width = 0;
+    unsigned int         height = 0;
+    const unsigned char* bgra = nullptr;    // width * height * 4 bytes, bottom row first
+    const unsigned char* mips = nullptr;    // reduced levels of the frame's atlas cell
+                                            // (see SpriteCell.h), if precomputed
+
+    bool empty() const
+    {
+        return bgra == nullptr  ||  width == 0  ||  height == 0;
+    }
+};
+
+struct TgaImage
+{
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<unsigned char> bgra;
+
+    bool empty() const
+    {
+        return bgra.empty();
+    }
+
+    ImageView view() const
+    {
+        ImageView v;
+        v.width = width;
+        v.height = height;
+        v.bgra = bgra.data();
+        return v;
+    }
+
+    bool load(const std::string& fileName)
+    {
+        std::ifstream tgaFile(fileName, std::ios::in|std::ios::binary);
+        if (!tgaFile)
+            return false;
+        tgaFile.seekg(0, std::ios::end);
+        std::streamoff size = tgaFile.tellg();
+        if (size <= 0)
+            return false;
+        std::vector<unsigned char> data(static_cast<size_t>(size));
+        tgaFile.seekg(0);
+        tgaFile.read(reinterpret_cast<char*>(data.data()), size);
+        if (!tgaFile)
+            return false;
+        return decode(data.data(), data.size());
+    }
+
+      // Decode a whole TGA file held in memory.  On failure the image is
+      // left empty.
+    bool decode(const unsigned char* data, size_t size)
+    {
+        width = height = 0;
+        bgra.clear();
+        if (size < HEADER_SIZE)
+            return false;
+
+        unsigned int idLength      = data[0];
+        unsigned int colorMapType  = data[1];
+        unsigned int imageType     = data[2];
+        unsigned int colorMapCount = data[5] | data[6] << 8;
+        unsigned int colorMapBits  = data[7];
+        unsigned int w             = data[12] | data[13] << 8;
+        unsigned int h             = data[14] | data[15] << 8;
+        unsigned int depth         = data[16];
+        unsigned int descriptor    = data[17];
+
+        bool rle = (imageType == 10  ||  imageType == 11);
+        bool grey = (imageType == 3  ||  imageType == 11);
+        if (imageType != 2  &&  imageType != 3  &&  !rle)
+            return false;
+        if (colorMapType > 1  ||  w == 0  ||  h == 0)
+            return false;
+          // greyscale stored at 24 or 32 bits goes through the true color path
+        if (depth != 24  &&  depth != 32  &&  !(grey  &&  depth == 8))
+            return false;
+
+          // skip the image ID and any (unused) color map
+        size_t offset = HEADER_SIZE + idLength;
+        if (colorMapType == 1)
+            offset += static_cast<size_t>(colorMapCount) * ((colorMapBits + 7) / 8);
+        if (offset > size)
+            return false;
+
+        size_t bytesPerPixel = depth / 8;
+        size_t pixels = static_cast<size_t>(w) * h;
+        std::vector<unsigned char> out(pixels * 4);
+        auto put = [&out, bytesPerPixel](size_t p, const unsigned char* px)
+        {
+            unsigned char* o = &out[4 * p];
+            if (bytesPerPixel == 1)
+            {
+                o[0] = o[1] = o[2] = px[0];
+                o[3] = 255;
+            }
+            else
+            {
+                o[0] = px[0];
+                o[1] = px[1];
+                o[2] = px[2];
+                o[3] = (bytesPerPixel == 4 ? px[3] : 255);
+            }
+        };
+
+        if (!rle)
+        {
+            if ((size - offset) / bytesPerPixel < pixels)
+                return false;
+            for (size_t p = 0; p < pixels; p++)
+                put(p, data + offset + p * bytesPerPixel);
+        }
+        else
+        {
+            size_t p = 0;
+            while (p < pixels)
+            {
+                if (offset >= size)
+                    return false;
+                unsigned char packet = data[offset++];
+                size_t count = (packet & 0x7f) + 1u;
+                if (count > pixels - p)
+                    return false;           // a run may not spill past the image
+                if (packet & 0x80)
+                {
+                    if (size - offset < bytesPerPixel)
+                        return false;
+                    for (size_t k = 0; k < count; k++)
+                        put(p++, data + offset);
+                    offset += bytesPerPixel;
+                }
+                else
+                {
+                    if ((size - offset) / bytesPerPixel < count)
+                        return false;
+                    for (size_t k = 0; k < count; k++, offset += bytesPerPixel)
+                        put(p++, data + offset);
+                }
+            }
+        }
+
+          // normalize the origin to the bottom left
+        if (descriptor & 0x20)
+        {
+            for (unsigned int y = 0; y < h / 2; y++)
+                std::swap_ranges(out.begin() + static_cast<size_t>(y) * w * 4,
+                                 out.begin() + static_cast<size_t>(y + 1) * w * 4,
+                                 out.begin() + static_cast<size_t>(h - 1 - y) * w * 4);
+        }
+        if (descriptor & 0x10)
+        {
+            for (unsigned int y = 0; y < h; y++)
+            {
+                unsigned char* row = &out[static_cast<size_t>(y) * w * 4];
+                for (unsigned int x = 0; x < w / 2; x++)
+                    std::swap_ranges(row + 4 * x, row + 4 * x + 4, row + 4 * (w - 1 - x));
+            }
+        }
+
+        width = w;
+        height = h;
+        bgra.swap(out);
+        return true;
+    }
+
+      // Decode every file, spread over worker threads.  An image that could
+      // not be loaded is left empty.  If given, completed counts the files
+      // done so far, for showing progress.
+    static std::vector<TgaImage> loadAll(const std::vector<std::string>& fileNames,
+                                         std::atomic<int>* completed = nullptr)
+    {
+        std::vector<TgaImage> images(fileNames.size());
+        std::atomic<size_t> next(0);
+        auto work = [&]()
+        {
+            for (size_t k; (k = next++) < fileNames.size(); )
+            {
+                TRACE_SCOPE_DETAIL("assets", "decode", fileNames[k].c_str());
+                images[k].load(fileNames[k]);
+                if (completed != nullptr)
+                    (*completed)++;
+            }
+        };
+        size_t numWorkers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), fileNames.size());
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < numWorkers; t++)
+            workers.emplace_back([&work] { Tracer::nameThread("decoder"); work(); });
+        work();     // this thread helps too
+        for (std::thread& worker : workers)
+            worker.join();
+        return images;
+    }
+
+  private:
+    static const size_t HEADER_SIZE = 18;
+};
+
+#endif // TGAIMAGE_H_
@@ -0,0 +1,92 @@
+#ifndef TICKEVENTS_H_
+#define TICKEVENTS_H_
+
+#include "StateHash.h"
+#include <vector>
+#include <cstdint>
+#include <ostream>
+
+  // Side effects requested by actors during a tick.  They are recorded as
+  // compact events while the actors are being iterated and applied in bulk
+  // once the tick is over, after coalescing: each sound plays at most once
+  // per tick, and score and lives changes are summed.  The raw stream is
+  // kept until the next tick so replays and telemetry can read it.
+
+struct TickEvent
+{
+    enum Type : uint8_t { sound, score, lives, spawn, NUM_TYPES };
+
+    Type    type;
+    int32_t value;      // sound ID, delta, or image ID of the spawned actor
+};
+
+struct TickEventTelemetry
+{
+    long long recorded[TickEvent::NUM_TYPES] = {};   // as requested by actors
+    long long applied[TickEvent::NUM_TYPES] = {};    // after coalescing
+    long long ticks = 0;
+    size_t    maxEventsInTick = 0;
+
+    void print(std::ostream& os) const
+    {
+        static const char* names[TickEvent::NUM_TYPES] = { "sound", "score", "lives", "spawn" };
+        os << "Tick events over " << ticks << " ticks (max " << maxEventsInTick << " in one):";
+        for (int t = 0; t < TickEvent::NUM_TYPES; t++)
+            os << ' ' << names[t] << ' ' << recorded[t] << "->" << applied[t];
+        os << std::endl;
+    }
+};
+
+class TickEventBuffer
+{
+  public:
+    void record(TickEvent::Type type, int32_t value)
+    {
+        m_events.push_back(TickEvent{ type, value });
+        m_telemetry.recorded[type]++;
+    }
+
+    void noteApplied(TickEvent::Type type)
+    {
+        m_telemetry.applied[type]++;
+    }
+
+      // Start a new tick, forgetting the previous tick's stream.
+    void clear()
+    {
+        m_events.clear();
+    }
+
+      // Close the tick's stream for telemetry.
+    void endTick()
+    {
+        m_telemetry.ticks++;
+        if (m_events.size() > m_telemetry.maxEventsInTick)
+            m_telemetry.maxEventsInTick = m_events.size();
+    }
+
+    const std::vector<TickEvent>& events() const
+    {
+        return m_events;
+    }
+
+      // Order-sensitive hash of the raw stream, for replay verification.
+    uint64_t hash() const
+    {
+        uint64_t h = StateHash::mix(0, static_cast<uint64_t>(m_events.size()));
+        for (const TickEvent& e : m_events)
+            h = StateHash::mix(StateHash::mix(h, static_cast<int>(e.type)), static_cast<int>(e.value));
+        return h;
+    }
+
+    const TickEventTelemetry& telemetry() const
+    {
+        return m_telemetry;
+    }
+
+  private:
+    std::vector<TickEvent> m_events;
+    TickEventTelemetry     m_telemetry;
+};
+
+#endif // TICKEVENTS_H_
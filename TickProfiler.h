@@ -0,0 +1,257 @@
+#ifndef TICKPROFILER_H_
+#define TICKPROFILER_H_
+
+#include "Tracer.h"
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+  // Where the time in StudentWorld::move goes, phase by phase.  Compiled
+  // in only when KONTAGION_PROFILE is defined; otherwise the PROFILE_
+  // macros below only mark the phases for the tracer, which costs nothing
+  // more than a test of whether it is running.
+  //
+  // Phases are laps: starting one ends the one before, so a tick that
+  // returns early still closes whatever phase it was in.  Each phase feeds
+  // two histograms, one for the level being played and one for the run.
+
+  // Durations in nanoseconds, in buckets that double in width every
+  // SUB_BUCKETS buckets, so any percentile is read off to within 1 part in
+  // SUB_BUCKETS from 1 ns to hours.  Only one thread records, and it does so
+  // with plain atomic loads and stores, never a locked instruction; any
+  // thread may read at any time and sees counts at most a sample behind.
+
+class PhaseHistogram
+{
+  public:
+    static const int SUB_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    PhaseHistogram()
+    {
+        reset();
+    }
+
+      // Recording thread only.
+    void record(uint64_t ns)
+    {
+        bump(m_buckets[bucketOf(ns)], 1);
+        bump(m_count, 1);
+        bump(m_totalNs, ns);
+        if (ns > m_maxNs.load(std::memory_order_relaxed))
+            m_maxNs.store(ns, std::memory_order_relaxed);
+    }
+
+      // Recording thread only.
+    void reset()
+    {
+        for (std::atomic<uint64_t>& b : m_buckets)
+            b.store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_totalNs.store(0, std::memory_order_relaxed);
+        m_maxNs.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const
+    {
+        return m_count.load(std::memory_order_relaxed);
+    }
+
+      // the upper edge of the bucket holding the p-th percentile
+    uint64_t percentileNs(double p) const
+    {
+        uint64_t n = count();
+        uint64_t maxNs = m_maxNs.load(std::memory_order_relaxed);
+        if (n == 0)
+            return 0;
+        uint64_t rank = std::max<uint64_t>(1, std::min<uint64_t>(n, static_cast<uint64_t>(p / 100 * n + 0.5)));
+        uint64_t seen = 0;
+        for (int b = 0; b < NUM_BUCKETS; b++)
+        {
+            seen += m_buckets[b].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return std::min(upperEdge(b), maxNs);
+        }
+        return maxNs;
+    }
+
+    void print(std::ostream& os, const char* name) const
+    {
+        uint64_t n = count();
+        os << std::fixed << std::setprecision(1) << "  " << std::left << std::setw(8) << name << std::right
+           << n << " ticks";
+        if (n > 0)
+        {
+            os << ", avg " << m_totalNs.load(std::memory_order_relaxed) / 1000.0 / n
+               << " us, p50 " << percentileNs(50) / 1000.0 << " us, p90 " << percentileNs(90) / 1000.0
+               << " us, p99 " << percentileNs(99) / 1000.0 << " us, max "
+               << m_maxNs.load(std::memory_order_relaxed) / 1000.0 << " us";
+        }
+        os << std::endl;
+    }
+
+  private:
+    std::atomic<uint64_t> m_buckets[NUM_BUCKETS];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_totalNs;
+    std::atomic<uint64_t> m_maxNs;
+
+    static void bump(std::atomic<uint64_t>& a, uint64_t by)
+    {
+        a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    static int highestBit(uint64_t v)
+    {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(v);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanReverse64(&index, v);
+        return static_cast<int>(index);
+#else
+        int bit = 0;
+        while (v >>= 1)
+            bit++;
+        return bit;
+#endif
+    }
+
+    static int bucketOf(uint64_t ns)
+    {
+        if (ns < static_cast<uint64_t>(SUB_BUCKETS))
+            return static_cast<int>(ns);
+        int top = highestBit(ns);
+        return (top - SUB_BITS + 1) * SUB_BUCKETS + static_cast<int>((ns >> (top - SUB_BITS)) & (SUB_BUCKETS - 1));
+    }
+
+    static uint64_t upperEdge(int bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+            return static_cast<uint64_t>(bucket);
+        int top = bucket / SUB_BUCKETS + SUB_BITS - 1;
+        uint64_t width = uint64_t(1) << (top - SUB_BITS);
+        return (SUB_BUCKETS + static_cast<uint64_t>(bucket % SUB_BUCKETS)) * width + width - 1;
+    }
+};
+
+class TickProfiler
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Phase { player, actors, reap, spawn, events, hud, NUM_PHASES };
+
+    static TickProfiler& instance()
+    {
+        static TickProfiler profiler;
+        return profiler;
+    }
+
+    void beginTick()
+    {
+        m_tickStart = Clock::now();
+        m_phaseStart = m_tickStart;
+        m_phase = -1;
+    }
+
+      // End the current phase, if any, and start the given one.
+    void phase(Phase p)
+    {
+        Clock::time_point now = Clock::now();
+        endPhase(now);
+        m_phase = p;
+        m_phaseStart = now;
+    }
+
+    void endTick()
+    {
+        Clock::time_point now = Clock::now();
+        endPhase(now);
+        m_phase = -1;
+        uint64_t ns = nsBetween(m_tickStart, now);
+        m_level[NUM_PHASES].record(ns);
+        m_run[NUM_PHASES].record(ns);
+    }
+
+      // Print the level's summary and start counting the next one afresh.
+    void endLevel(std::ostream& os, int level, const char* outcome)
+    {
+        os << "Tick phases, level " << level << " (" << outcome << "):" << std::endl;
+        print(os, m_level);
+        for (PhaseHistogram& h : m_level)
+            h.reset();
+    }
+
+    void printRun(std::ostream& os) const
+    {
+        os << "Tick phases, whole run:" << std::endl;
+        print(os, m_run);
+    }
+
+    static const char* phaseName(int p)
+    {
+        static const char* names[NUM_PHASES + 1] = { "player", "actors", "reap", "spawn", "events", "hud", "tick" };
+        return names[p];
+    }
+
+    TickProfiler(const TickProfiler&) = delete;
+    TickProfiler& operator=(const TickProfiler&) = delete;
+
+  private:
+    PhaseHistogram    m_level[NUM_PHASES + 1];  // the last is the whole tick
+    PhaseHistogram    m_run[NUM_PHASES + 1];
+    Clock::time_point m_tickStart;
+    Clock::time_point m_phaseStart;
+    int               m_phase = -1;
+
+    TickProfiler()
+    {
+    }
+
+    void endPhase(Clock::time_point now)
+    {
+        if (m_phase < 0)
+            return;
+        uint64_t ns = nsBetween(m_phaseStart, now);
+        m_level[m_phase].record(ns);
+        m_run[m_phase].record(ns);
+    }
+
+    static void print(std::ostream& os, const PhaseHistogram* histograms)
+    {
+        for (int p = 0; p <= NUM_PHASES; p++)
+            histograms[p].print(os, phaseName(p));
+    }
+
+    static uint64_t nsBetween(Clock::time_point from, Clock::time_point to)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+    }
+};
+
+#define TRACE_PHASE(p)                          TRACE_LAP("world", TickProfiler::phaseName(TickProfiler::p))
+
+#ifdef KONTAGION_PROFILE
+#define PROFILE_TICK_BEGIN()                    TickProfiler::instance().beginTick()
+#define PROFILE_PHASE(p)                        (TickProfiler::instance().phase(TickProfiler::p), TRACE_PHASE(p))
+#define PROFILE_TICK_END()                      (TickProfiler::instance().endTick(), TRACE_END_LAP())
+#define PROFILE_LEVEL_END(os, level, outcome)   TickProfiler::instance().endLevel(os, level, outcome)
+#define PROFILE_REPORT(os)                      TickProfiler::instance().printRun(os)
+#else
+#define PROFILE_TICK_BEGIN()                    ((void)0)
+#define PROFILE_PHASE(p)                        TRACE_PHASE(p)
+#define PROFILE_TICK_END()                      TRACE_END_LAP()
+#define PROFILE_LEVEL_END(os, level, outcome)   ((void)0)
+#define PROFILE_REPORT(os)                      ((void)0)
+#endif
+
+#endif // TICKPROFILER_H_
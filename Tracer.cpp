@@ -0,0 +1,224 @@
+#include "Tracer.h"
+#include <cstring>
+#include <cstdio>
+using namespace std;
+
+atomic<bool> Tracer::s_enabled(false);
+
+static thread_local const char* t_threadName = nullptr;
+
+static int64_t nsSince(Tracer::Clock::time_point from, Tracer::Clock::time_point t)
+{
+    return chrono::duration_cast<chrono::nanoseconds>(t - from).count();
+}
+
+static void writeString(ofstream& f, const char* s)
+{
+    f << '"';
+    for (; *s != '\0'; s++)
+    {
+        if (*s == '"'  ||  *s == '\\')
+            f << '\\' << *s;
+        else if (static_cast<unsigned char>(*s) >= ' ')
+            f << *s;
+    }
+    f << '"';
+}
+
+Tracer::~Tracer()
+{
+    stop();
+    for (unique_ptr<ThreadBuffer>& b : m_buffers)
+    {
+        for (Chunk* c = b->head; c != nullptr; )
+        {
+            Chunk* next = c->next.load(memory_order_acquire);
+            delete c;
+            c = next;
+        }
+    }
+}
+
+bool Tracer::start(const string& fileName)
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (m_file.is_open())
+        return false;
+    m_file.open(fileName, ios::out|ios::trunc);
+    if (!m_file)
+        return false;
+    m_file << "[\n";
+    m_firstEvent = true;
+      // Whatever was recorded after the last trace was flushed belongs to
+      // that one; drop it, and name every thread again in the new file.
+    for (unique_ptr<ThreadBuffer>& b : m_buffers)
+    {
+        drain(*b, false);
+        b->named = false;
+    }
+    m_epoch.store(Clock::now().time_since_epoch().count(), memory_order_relaxed);
+    s_enabled.store(true, memory_order_release);
+    return true;
+}
+
+void Tracer::stop()
+{
+      // Off first, so nothing new is recorded once the last flush is done.
+    if (!s_enabled.exchange(false, memory_order_acq_rel))
+        return;
+    flush();
+    lock_guard<mutex> lock(m_mutex);
+    m_file << "\n]\n";
+    m_file.close();
+}
+
+void Tracer::flush()
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (!m_file.is_open())
+        return;
+    for (unique_ptr<ThreadBuffer>& b : m_buffers)
+    {
+        if (!b->named)
+        {
+            char fallback[24];
+            snprintf(fallback, sizeof(fallback), "thread %d", b->tid);
+            writeSeparator();
+            m_file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid << ",\"args\":{\"name\":";
+            writeString(m_file, b->name != nullptr ? b->name : fallback);
+            m_file << "}}";
+            b->named = true;
+        }
+        drain(*b, true);
+    }
+    m_file.flush();
+}
+
+  // Everything up to the owner's released count is complete.  A full chunk
+  // is freed once the owner has moved on to the next.  Called with m_mutex
+  // held.
+void Tracer::drain(ThreadBuffer& b, bool write)
+{
+    for (;;)
+    {
+        int count = b.head->count.load(memory_order_acquire);
+        if (write)
+        {
+            for (; b.flushed < count; b.flushed++)
+                writeEvent(b, b.head->events[b.flushed]);
+        }
+        else
+            b.flushed = count;
+        Chunk* next = (b.flushed == Chunk::SIZE ? b.head->next.load(memory_order_acquire) : nullptr);
+        if (next == nullptr)
+            break;
+        delete b.head;
+        b.head = next;
+        b.flushed = 0;
+    }
+}
+
+void Tracer::writeSeparator()
+{
+    if (!m_firstEvent)
+        m_file << ",\n";
+    m_firstEvent = false;
+}
+
+void Tracer::writeEvent(const ThreadBuffer& buffer, const TraceEvent& e)
+{
+    char times[64];
+    snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", e.startNs / 1000.0, e.durationNs / 1000.0);
+    writeSeparator();
+    m_file << "{\"name\":";
+    writeString(m_file, e.name);
+    m_file << ",\"cat\":";
+    writeString(m_file, e.category);
+    m_file << ",\"ph\":\"X\"," << times << ",\"pid\":1,\"tid\":" << buffer.tid;
+    if (e.detail[0] != '\0')
+    {
+        m_file << ",\"args\":{\"detail\":";
+        writeString(m_file, e.detail);
+        m_file << '}';
+    }
+    m_file << '}';
+    m_eventsWritten++;
+}
+
+void Tracer::nameThread(const char* name)
+{
+    t_threadName = name;
+}
+
+Tracer::ThreadBuffer& Tracer::threadBuffer()
+{
+    static thread_local ThreadBuffer* t_buffer = nullptr;
+    if (t_buffer == nullptr)
+    {
+        Tracer& tracer = instance();
+        unique_ptr<ThreadBuffer> b(new ThreadBuffer);
+        b->name = t_threadName;
+        b->head = b->tail = new Chunk;
+        b->flushed = 0;
+        b->lapCategory = b->lapName = nullptr;
+        b->named = false;
+        lock_guard<mutex> lock(tracer.m_mutex);
+        b->tid = static_cast<int>(tracer.m_buffers.size()) + 1;
+        t_buffer = b.get();
+        tracer.m_buffers.push_back(move(b));
+    }
+    return *t_buffer;
+}
+
+void Tracer::record(const char* category, const char* name, Clock::time_point start,
+                    Clock::time_point end, const char* detail)
+{
+      // A scope or lap begun before this trace started, or one ending after
+      // it stopped, is left out.
+    if (!enabled())
+        return;
+    Clock::time_point epoch(Clock::duration(instance().m_epoch.load(memory_order_relaxed)));
+    if (start < epoch)
+        return;
+    ThreadBuffer& b = threadBuffer();
+    Chunk* chunk = b.tail;
+    int n = chunk->count.load(memory_order_relaxed);
+    if (n == Chunk::SIZE)
+    {
+        Chunk* fresh = new Chunk;
+        chunk->next.store(fresh, memory_order_release);
+        b.tail = chunk = fresh;
+        n = 0;
+    }
+    TraceEvent& e = chunk->events[n];
+    e.category = category;
+    e.name = name;
+    e.startNs = nsSince(epoch, start);
+    e.durationNs = nsSince(start, end);
+    e.detail[0] = '\0';
+    if (detail != nullptr)
+    {
+        strncpy(e.detail, detail, TraceEvent::DETAIL_SIZE - 1);
+        e.detail[TraceEvent::DETAIL_SIZE - 1] = '\0';
+    }
+    chunk->count.store(n + 1, memory_order_release);
+}
+
+void Tracer::lap(const char* category, const char* name)
+{
+    ThreadBuffer& b = threadBuffer();
+    Clock::time_point now = Clock::now();
+    if (b.lapName != nullptr)
+        record(b.lapCategory, b.lapName, b.lapStart, now);
+    b.lapCategory = category;
+    b.lapName = name;
+    b.lapStart = now;
+}
+
+void Tracer::endLap()
+{
+    ThreadBuffer& b = threadBuffer();
+    if (b.lapName != nullptr)
+        record(b.lapCategory, b.lapName, b.lapStart, Clock::now());
+    b.lapName = nullptr;
+}
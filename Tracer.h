@@ -0,0 +1,155 @@
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+  // Writes what the game's threads are doing as trace_event JSON, for
+  // chrome://tracing or Perfetto.  Off unless started; while it is off, a
+  // traced scope costs one load.
+  //
+  // Each thread appends its events to a buffer of its own, a chain of
+  // fixed-size chunks that only it writes and only flush() reads, so
+  // recording takes no lock and never waits (it allocates once every
+  // Chunk::SIZE events).  flush() moves everything recorded so far into the
+  // file; it runs at level end, on demand and at stop().  The file is a
+  // bare JSON array, which the viewers accept without its closing bracket,
+  // so what was flushed before a crash can still be opened.
+  //
+  // Names and categories must be string literals, or otherwise outlive the
+  // tracer; a detail is copied, and cut short if long.
+
+struct TraceEvent
+{
+    static const int DETAIL_SIZE = 40;
+
+    const char* category;
+    const char* name;
+    int64_t     startNs;        // since the tracer started
+    int64_t     durationNs;
+    char        detail[DETAIL_SIZE];
+};
+
+class Tracer
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static Tracer& instance()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    static bool enabled()
+    {
+        return s_enabled.load(std::memory_order_acquire);
+    }
+
+    bool start(const std::string& fileName);
+    void flush();
+    void stop();
+
+      // What the calling thread is called in the trace; set before it
+      // records anything.
+    static void nameThread(const char* name);
+
+    static void record(const char* category, const char* name, Clock::time_point start,
+                       Clock::time_point end, const char* detail = nullptr);
+
+      // Laps on the calling thread: starting one ends the one before.
+    static void lap(const char* category, const char* name);
+    static void endLap();
+
+    long long eventsWritten() const
+    {
+        return m_eventsWritten;
+    }
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+  private:
+    struct Chunk
+    {
+        static const int SIZE = 1024;
+
+        TraceEvent          events[SIZE];
+        std::atomic<int>    count{ 0 };          // written by the owner, released
+        std::atomic<Chunk*> next{ nullptr };     // set once this one is full
+    };
+
+    struct ThreadBuffer
+    {
+        int               tid;
+        const char*       name;
+        Chunk*            head;         // oldest chunk not yet flushed; flush() only
+        int               flushed;      // events of head already flushed
+        Chunk*            tail;         // being written; owner only
+        const char*       lapCategory;  // owner only
+        const char*       lapName;
+        Clock::time_point lapStart;
+        bool              named;        // thread name written; flush() only
+    };
+
+    static std::atomic<bool> s_enabled;
+
+    std::mutex                                 m_mutex;     // buffers list and the file
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    std::ofstream                              m_file;
+    std::atomic<Clock::rep>                    m_epoch{ 0 };  // when started, in Clock ticks; released by s_enabled
+    long long                                  m_eventsWritten = 0;
+    bool                                       m_firstEvent = true;
+
+    Tracer()
+    {
+    }
+
+    ~Tracer();
+
+    static ThreadBuffer& threadBuffer();
+    void drain(ThreadBuffer& buffer, bool write);
+    void writeEvent(const ThreadBuffer& buffer, const TraceEvent& e);
+    void writeSeparator();
+};
+
+  // Records its lifetime as one event, if the tracer is running.
+class TraceScope
+{
+  public:
+    TraceScope(const char* category, const char* name, const char* detail = nullptr)
+     : m_category(category), m_name(name), m_detail(detail), m_active(Tracer::enabled())
+    {
+        if (m_active)
+            m_start = Tracer::Clock::now();
+    }
+
+    ~TraceScope()
+    {
+        if (m_active)
+            Tracer::record(m_category, m_name, m_start, Tracer::Clock::now(), m_detail);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+  private:
+    const char*              m_category;
+    const char*              m_name;
+    const char*              m_detail;
+    bool                     m_active;
+    Tracer::Clock::time_point m_start;
+};
+
+#define TRACE_SCOPE(category, name)                 TraceScope traceScope(category, name)
+#define TRACE_SCOPE_DETAIL(category, name, detail)  TraceScope traceScope(category, name, detail)
+#define TRACE_LAP(category, name)                   (Tracer::enabled() ? Tracer::lap(category, name) : (void)0)
+#define TRACE_END_LAP()                             (Tracer::enabled() ? Tracer::endLap() : (void)0)
+
+#endif // TRACER_H_
@@ -0,0 +1,60 @@
+#ifndef TRIPLEBUFFER_H_
+#define TRIPLEBUFFER_H_
+
+#include <atomic>
+
+  // Lock-free single-producer/single-consumer triple buffer.  The writer
+  // fills back(), then publish() swaps it with the shared middle slot; the
+  // reader's latest() swaps the middle slot in only if something new was
+  // published since the last call.  Neither side ever waits, the reader
+  // always sees a complete value, and slots keep their allocations, so a
+  // steady state publishes without allocating.
+
+template<typename T>
+class TripleBuffer
+{
+  public:
+    TripleBuffer()
+     : m_back(0), m_middle(1), m_front(2)
+    {
+    }
+
+      // Writer side
+    T& back()
+    {
+        return m_slots[m_back];
+    }
+
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+      // Reader side: the most recently published value.
+    const T& latest()
+    {
+        if (m_middle.load(std::memory_order_relaxed) & FRESH)
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        return m_slots[m_front];
+    }
+
+      // Reader side: whether latest() would return something new.
+    bool hasFresh() const
+    {
+        return (m_middle.load(std::memory_order_relaxed) & FRESH) != 0;
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;
+
+    T                m_slots[3];
+    int              m_back;
+    std::atomic<int> m_middle;
+    int              m_front;
+};
+
+#endif // TRIPLEBUFFER_H_
@@ -0,0 +1,192 @@
+#ifndef VOICEMANAGER_H_
+#define VOICEMANAGER_H_
+
+#include <vector>
+#include <ostream>
+
+  // How a sound competes for voices.  Higher priorities may steal voices
+  // from lower ones; a sound never has more than maxInstances voices at
+  // once; and it is not restarted within minRetriggerMs of its last start.
+
+struct VoicePolicy
+{
+    int    priority = 0;
+    int    maxInstances = 4;
+    double minRetriggerMs = 0;
+};
+
+struct VoiceStats
+{
+    long long granted = 0;
+    long long stolen = 0;           // granted by cutting another voice short
+    long long droppedRetrigger = 0;
+    long long droppedPriority = 0;  // every voice busy with something more important
+
+    void print(std::ostream& os) const
+    {
+        os << "Voices: " << granted << " granted (" << stolen << " by stealing), "
+           << droppedRetrigger << " dropped as retriggers, "
+           << droppedPriority << " dropped for priority" << std::endl;
+    }
+};
+
+  // Decides which voice, if any, a newly requested sound plays on.  It knows
+  // each clip's length, so it can tell when a voice frees up without asking
+  // the backend.  Times are in milliseconds on whatever clock the backend
+  // uses, as long as it is used consistently.
+
+class VoiceManager
+{
+  public:
+    static const int NO_VOICE = -1;
+
+    explicit VoiceManager(int numVoices = 1)
+    {
+        setVoiceCount(numVoices);
+    }
+
+    void setVoiceCount(int numVoices)
+    {
+        m_voices.assign(numVoices > 0 ? numVoices : 1, Voice());
+    }
+
+    int voiceCount() const
+    {
+        return static_cast<int>(m_voices.size());
+    }
+
+    void setPolicy(int soundID, const VoicePolicy& policy)
+    {
+        if (soundID < 0)
+            return;
+        grow(soundID);
+        m_policies[soundID] = policy;
+        if (m_policies[soundID].maxInstances < 1)
+            m_policies[soundID].maxInstances = 1;   // a cap of none would leave nothing to restart
+    }
+
+    void setDuration(int soundID, double ms)
+    {
+        if (soundID < 0)
+            return;
+        grow(soundID);
+        m_durations[soundID] = ms;
+    }
+
+      // Returns the voice to play soundID on, or NO_VOICE to skip it.  When
+      // stolen is set, the voice is still sounding and must be cut first.
+    int acquire(int soundID, double nowMs, bool& stolen)
+    {
+        stolen = false;
+        if (soundID < 0)
+            return NO_VOICE;
+        grow(soundID);
+        const VoicePolicy& policy = m_policies[soundID];
+        if (m_lastStart[soundID] >= 0  &&  nowMs - m_lastStart[soundID] < policy.minRetriggerMs)
+        {
+            m_stats.droppedRetrigger++;
+            return NO_VOICE;
+        }
+
+        int chosen = NO_VOICE;
+        int instances = 0;
+        int oldestSame = NO_VOICE;
+        int victim = NO_VOICE;
+        for (int v = 0; v < voiceCount(); v++)
+        {
+            const Voice& voice = m_voices[v];
+            if (!busy(voice, nowMs))
+            {
+                if (chosen == NO_VOICE)
+                    chosen = v;
+                continue;
+            }
+            if (voice.soundID == soundID)
+            {
+                instances++;
+                if (oldestSame == NO_VOICE  ||  voice.start < m_voices[oldestSame].start)
+                    oldestSame = v;
+            }
+              // lowest priority, then oldest, is the first to go
+            if (victim == NO_VOICE  ||  voice.priority < m_voices[victim].priority  ||
+                (voice.priority == m_voices[victim].priority  &&  voice.start < m_voices[victim].start))
+                victim = v;
+        }
+
+        if (instances >= policy.maxInstances)
+        {
+              // at the cap: restart the oldest instance rather than add one
+            chosen = oldestSame;
+            stolen = true;
+        }
+        else if (chosen == NO_VOICE)
+        {
+            if (victim == NO_VOICE  ||  m_voices[victim].priority > policy.priority)
+            {
+                m_stats.droppedPriority++;
+                return NO_VOICE;
+            }
+            chosen = victim;
+            stolen = true;
+        }
+
+        Voice& voice = m_voices[chosen];
+        voice.soundID = soundID;
+        voice.priority = policy.priority;
+        voice.start = nowMs;
+        voice.end = nowMs + m_durations[soundID];
+        m_lastStart[soundID] = nowMs;
+        m_stats.granted++;
+        if (stolen)
+            m_stats.stolen++;
+        return chosen;
+    }
+
+    void release(int voice)
+    {
+        if (voice >= 0  &&  voice < voiceCount())
+            m_voices[voice] = Voice();
+    }
+
+    void releaseAll()
+    {
+        for (Voice& voice : m_voices)
+            voice = Voice();
+    }
+
+    const VoiceStats& stats() const
+    {
+        return m_stats;
+    }
+
+  private:
+    struct Voice
+    {
+        int    soundID = -1;
+        int    priority = 0;
+        double start = 0;
+        double end = 0;
+    };
+
+    std::vector<Voice>       m_voices;
+    std::vector<VoicePolicy> m_policies;
+    std::vector<double>      m_durations;
+    std::vector<double>      m_lastStart;
+    VoiceStats               m_stats;
+
+    static bool busy(const Voice& voice, double nowMs)
+    {
+        return voice.soundID >= 0  &&  nowMs < voice.end;
+    }
+
+    void grow(int soundID)
+    {
+        if (soundID < static_cast<int>(m_policies.size()))
+            return;
+        m_policies.resize(soundID + 1);
+        m_durations.resize(soundID + 1, 0);
+        m_lastStart.resize(soundID + 1, -1);
+    }
+};
+
+#endif // VOICEMANAGER_H_
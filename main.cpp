@@ -1,7 +1,9 @@
 #include "GameController.h"
+#include "AssetBundle.h"
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstring>
 using namespace std;
 
 #ifdef _MSC_VER
@@ -26,14 +28,38 @@ bool is_directory(string path)
 
 const string assetDirectory = "Assets"; 
 
+  // Every asset packed into one file by  kontagion --pack-assets ; used in
+  // preference to the directory when present, unless something in the
+  // directory has changed since it was packed.
+
+const string assetBundle = assetDirectory + ".bundle";
+
 class GameWorld;
 
 GameWorld* createStudentWorld(string assetPath = "");
 
 int main(int argc, char* argv[])
 {
+    const string packedFrom = (assetDirectory.empty() ? "." : assetDirectory);
+    if (argc > 1  &&  strcmp(argv[1], "--pack-assets") == 0)
+        return AssetBundle::pack(packedFrom, assetBundle, cout) ? 0 : 1;
+
     string assetPath = assetDirectory;
-    if (!assetPath.empty())
+    static AssetBundle bundle;
+    bool stale = AssetBundle::isOlderThan(assetBundle, packedFrom);
+    if (stale)
+    {
+        cout << "Not using " << assetBundle << ": " << packedFrom
+             << " has changed since it was packed; run kontagion --pack-assets" << endl;
+    }
+    if (!stale  &&  bundle.open(assetBundle))
+    {
+        cout << "Using " << assetBundle << endl;
+        Game().setAssetBundle(&bundle);
+        if (!assetPath.empty())
+            assetPath += '/';
+    }
+    else if (!assetPath.empty())
     {
         if (!is_directory(assetPath))
         {
@@ -42,6 +68,7 @@ int main(int argc, char* argv[])
         }
         assetPath += '/';
     }
+    if (!bundle.isOpen())
     {
         const string someAsset = "socrates.tga";
         ifstream ifs(assetPath + someAsset);